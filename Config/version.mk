@@ -27,5 +27,5 @@
 # This must also serve as a shell script, so do not add spaces around the
 # `=' signs.
 
-VERSION=5.0.4-dev-0
+VERSION=5.0.4-dev-1
 VERSION_DATE='December 21, 2013'
@@ -576,6 +576,16 @@ funcsourcetracegetfn(UNUSED(Param pm))
     return ret;
 }
 
+/* Functions for the sourcedfiles special parameter. */
+
+/**/
+static char **
+sourcedfilesgetfn(UNUSED(Param pm))
+{
+    return sourcedfiles ? hlinklist2array(sourcedfiles, 1) :
+	hcalloc(sizeof(char *));
+}
+
 /* Functions for the funcfiletrace special parameter. */
 
 /**/
@@ -1482,6 +1492,71 @@ scanpmnameddirs(UNUSED(HashTable ht), ScanFunc func, int flags)
 	}
 }
 
+/* Functions for the parsecache special parameter. */
+
+static struct {
+    char *name;
+    zlong *valp;
+} parsecachestats[] = {
+    { "eval_entries", &evalcache_entries },
+    { "eval_hits", &evalcache_hits },
+    { "eval_misses", &evalcache_misses },
+    { "source_entries", &sourcecache_entries },
+    { "source_hits", &sourcecache_hits },
+    { "source_misses", &sourcecache_misses },
+    { NULL, NULL }
+};
+
+/**/
+static HashNode
+getpmparsecache(UNUSED(HashTable ht), const char *name)
+{
+    Param pm = NULL;
+    int i;
+
+    pm = (Param) hcalloc(sizeof(struct param));
+    pm->node.nam = dupstring(name);
+    pm->node.flags = PM_SCALAR | PM_READONLY;
+    pm->gsu.s = &nullsetscalar_gsu;
+    for (i = 0; parsecachestats[i].name; i++)
+	if (!strcmp(parsecachestats[i].name, name))
+	    break;
+    if (parsecachestats[i].name) {
+	char buf[DIGBUFSIZE];
+
+	convbase(buf, *parsecachestats[i].valp, 10);
+	pm->u.str = dupstring(buf);
+    } else {
+	pm->u.str = dupstring("");
+	pm->node.flags |= PM_UNSET;
+    }
+    return &pm->node;
+}
+
+/**/
+static void
+scanpmparsecache(UNUSED(HashTable ht), ScanFunc func, int flags)
+{
+    struct param pm;
+    char buf[DIGBUFSIZE];
+    int i;
+
+    memset((void *)&pm, 0, sizeof(struct param));
+    pm.node.flags = PM_SCALAR | PM_READONLY;
+    pm.gsu.s = &nullsetscalar_gsu;
+
+    for (i = 0; parsecachestats[i].name; i++) {
+	pm.node.nam = parsecachestats[i].name;
+	if (func != scancountparams &&
+	    ((flags & (SCANPM_WANTVALS|SCANPM_MATCHVAL)) ||
+	     !(flags & SCANPM_WANTKEYS))) {
+	    convbase(buf, *parsecachestats[i].valp, 10);
+	    pm.u.str = dupstring(buf);
+	}
+	func(&pm.node, flags);
+    }
+}
+
 /* Functions for the userdirs special parameter. */
 
 /**/
@@ -2046,6 +2121,8 @@ static const struct gsu_array funcsourcetrace_gsu =
 { funcsourcetracegetfn, arrsetfn, stdunsetfn };
 static const struct gsu_array funcfiletrace_gsu =
 { funcfiletracegetfn, arrsetfn, stdunsetfn };
+static const struct gsu_array sourcedfiles_gsu =
+{ sourcedfilesgetfn, arrsetfn, stdunsetfn };
 static const struct gsu_array reswords_gsu =
 { reswordsgetfn, arrsetfn, stdunsetfn };
 static const struct gsu_array disreswords_gsu =
@@ -2110,12 +2187,16 @@ static struct paramdef partab[] = {
 	    &pmoptions_gsu, getpmoption, scanpmoptions),
     SPECIALPMDEF("parameters", PM_READONLY,
 	    NULL, getpmparameter, scanpmparameters),
+    SPECIALPMDEF("parsecache", PM_READONLY,
+	    NULL, getpmparsecache, scanpmparsecache),
     SPECIALPMDEF("patchars", PM_ARRAY|PM_READONLY,
 	    &patchars_gsu, NULL, NULL),
     SPECIALPMDEF("reswords", PM_ARRAY|PM_READONLY,
 	    &reswords_gsu, NULL, NULL),
     SPECIALPMDEF("saliases", 0,
 	    &pmsaliases_gsu, getpmsalias, scanpmsaliases),
+    SPECIALPMDEF("sourcedfiles", PM_ARRAY|PM_READONLY,
+	    &sourcedfiles_gsu, NULL, NULL),
     SPECIALPMDEF("userdirs", PM_READONLY,
 	    NULL, getpmuserdir, scanpmuserdirs),
     SPECIALPMDEF("usergroups", PM_READONLY,
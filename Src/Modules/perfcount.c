@@ -0,0 +1,209 @@
+/*
+ * perfcount.c - counters of events in the shell
+ *
+ * This file is part of zsh, the Z shell.
+ *
+ * Copyright (c) 2013 Zsh Development Group
+ * All rights reserved.
+ *
+ * Permission is hereby granted, without written agreement and without
+ * license or royalty fees, to use, copy, modify, and distribute this
+ * software and to distribute modified versions of this software for any
+ * purpose, provided that the above copyright notice and the following
+ * two paragraphs appear in all copies of this software.
+ *
+ * In no event shall the Zsh Development Group be liable to any party
+ * for direct, indirect, special, incidental, or consequential damages
+ * arising out of the use of this software and its documentation, even
+ * if the Zsh Development Group have been advised of the possibility of
+ * such damage.
+ *
+ * The Zsh Development Group specifically disclaim any warranties,
+ * including, but not limited to, the implied warranties of
+ * merchantability and fitness for a particular purpose.  The software
+ * provided hereunder is on an "as is" basis, and the Zsh Development
+ * Group have no obligation to provide maintenance, support, updates,
+ * enhancements, or modifications.
+ *
+ */
+#include "perfcount.mdh"
+#include "perfcount.pro"
+
+/*
+ * The counters themselves are in perfcounts[] in the main shell so that
+ * they are always kept; this module only shows them.  The names are in
+ * the order of the PC_* indices.
+ */
+
+static const char *pcnames[PC_COUNT + 1] = {
+    "forks", "execs", "cmdsubsts", "patcompiles", "parses",
+    "hashlookups", "rehashes", "pushheaps", "popheaps", "autoloads",
+    NULL
+};
+
+/**/
+static int
+pcindex(const char *name)
+{
+    int i;
+
+    for (i = 0; i < PC_COUNT; i++)
+	if (!strcmp(pcnames[i], name))
+	    return i;
+    return -1;
+}
+
+/**/
+static HashNode
+getpmperfcount(UNUSED(HashTable ht), const char *name)
+{
+    Param pm;
+    int i = pcindex(name);
+
+    pm = (Param) hcalloc(sizeof(struct param));
+    pm->node.nam = dupstring(name);
+    pm->node.flags = PM_READONLY | PM_INTEGER;
+    pm->gsu.i = &nullsetinteger_gsu;
+    if (i >= 0)
+	pm->u.val = perfcounts[i];
+    else
+	pm->node.flags |= PM_UNSET;
+    return &pm->node;
+}
+
+/**/
+static void
+scanpmperfcounts(UNUSED(HashTable ht), ScanFunc func, int flags)
+{
+    Param pm;
+    int i;
+
+    pm = (Param) hcalloc(sizeof(struct param));
+    pm->node.flags = PM_READONLY | PM_INTEGER;
+    pm->gsu.i = &nullsetinteger_gsu;
+    for (i = 0; i < PC_COUNT; i++) {
+	pm->node.nam = dupstring(pcnames[i]);
+	pm->u.val = perfcounts[i];
+	func(&pm->node, flags);
+    }
+}
+
+static int
+bin_perfcount(char *nam, UNUSED(char **args), Options ops, UNUSED(int func))
+{
+    zlong counts[PC_COUNT], base[PC_COUNT];
+    int i;
+
+    /* What is done here isn't counted: the counts are put back later. */
+    memcpy(counts, perfcounts, sizeof(counts));
+    memset(base, 0, sizeof(base));
+    if (OPT_ISSET(ops,'d')) {
+	char *pnam = OPT_ARG(ops,'d');
+	Param pm = (Param) paramtab->getnode(paramtab, pnam), vpm;
+	HashTable ht;
+
+	if (!pm || (pm->node.flags & PM_UNSET) ||
+	    PM_TYPE(pm->node.flags) != PM_HASHED) {
+	    zwarnnam(nam, "no such association: %s", pnam);
+	    memcpy(perfcounts, counts, sizeof(counts));
+	    return 1;
+	}
+	ht = pm->gsu.h->getfn(pm);
+	for (i = 0; i < PC_COUNT; i++)
+	    if ((vpm = (Param) ht->getnode(ht, pcnames[i])))
+		base[i] = zstrtol(vpm->gsu.s->getfn(vpm), NULL, 10);
+    }
+    if (OPT_ISSET(ops,'s')) {
+	char **vals = (char **) zalloc((2 * PC_COUNT + 1) * sizeof(char *));
+	char buf[DIGBUFSIZE];
+
+	for (i = 0; i < PC_COUNT; i++) {
+	    vals[2 * i] = ztrdup(pcnames[i]);
+	    convbase(buf, counts[i], 10);
+	    vals[2 * i + 1] = ztrdup(buf);
+	}
+	vals[2 * PC_COUNT] = NULL;
+	if (!sethparam(OPT_ARG(ops,'s'), vals)) {
+	    memcpy(perfcounts, counts, sizeof(counts));
+	    return 1;
+	}
+    }
+    if (OPT_ISSET(ops,'d') ||
+	(!OPT_ISSET(ops,'r') && !OPT_ISSET(ops,'s'))) {
+	char buf[DIGBUFSIZE];
+
+	for (i = 0; i < PC_COUNT; i++) {
+	    /* With -d, only the counters that changed are shown. */
+	    if (OPT_ISSET(ops,'d') && counts[i] == base[i])
+		continue;
+	    convbase(buf, counts[i] - base[i], 10);
+	    printf("%-12s %s\n", pcnames[i], buf);
+	}
+	fflush(stdout);
+    }
+    if (OPT_ISSET(ops,'r'))
+	memset(perfcounts, 0, sizeof(perfcounts));
+    else
+	memcpy(perfcounts, counts, sizeof(counts));
+    return 0;
+}
+
+static struct builtin bintab[] = {
+    BUILTIN("perfcount", 0, bin_perfcount, 0, 0, 0, "d:rs:", NULL),
+};
+
+static struct paramdef partab[] = {
+    SPECIALPMDEF("perfcounts", PM_READONLY, NULL,
+		 getpmperfcount, scanpmperfcounts)
+};
+
+static struct features module_features = {
+    bintab, sizeof(bintab)/sizeof(*bintab),
+    NULL, 0,
+    NULL, 0,
+    partab, sizeof(partab)/sizeof(*partab),
+    0
+};
+
+/**/
+int
+setup_(UNUSED(Module m))
+{
+    return 0;
+}
+
+/**/
+int
+features_(Module m, char ***features)
+{
+    *features = featuresarray(m, &module_features);
+    return 0;
+}
+
+/**/
+int
+enables_(Module m, int **enables)
+{
+    return handlefeatures(m, &module_features, enables);
+}
+
+/**/
+int
+boot_(UNUSED(Module m))
+{
+    return 0;
+}
+
+/**/
+int
+cleanup_(Module m)
+{
+    return setfeatureenables(m, &module_features, NULL);
+}
+
+/**/
+int
+finish_(UNUSED(Module m))
+{
+    return 0;
+}
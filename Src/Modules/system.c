@@ -38,6 +38,7 @@
 #endif
 
 #define SYSREAD_BUFSIZE	8192
+#define SYSREADARRAY_BUFSIZE	65536
 
 /**/
 static int
@@ -227,6 +228,155 @@ bin_sysread(char *nam, char **args, Options ops, UNUSED(int func))
 }
 
 
+/*
+ * Return values of bin_sysreadarray:
+ *	0	Successfully read
+ *	1	Error in parameters to command
+ *	2	Error on read, ERRNO set by system
+ *	5	Zero bytes read, end of file
+ */
+
+/**/
+static int
+bin_sysreadarray(char *nam, char **args, Options ops, UNUSED(int func))
+{
+    int infd = 0, bufsize = SYSREADARRAY_BUFSIZE, maxcount = 0, skip = 0;
+    int start, scan, end, count, total, nelts, aelts;
+    char delim = '\n', *buf, *dptr, **arr;
+
+    if (!isident(*args)) {
+	zwarnnam(nam, "not an identifier: %s", *args);
+	return 1;
+    }
+
+    /* -i: input file descriptor if not stdin */
+    if (OPT_ISSET(ops, 'i')) {
+	infd = getposint(OPT_ARG(ops, 'i'), nam);
+	if (infd < 0)
+	    return 1;
+    }
+
+    /* -s: initial buffer size if not default SYSREADARRAY_BUFSIZE */
+    if (OPT_ISSET(ops, 's')) {
+	bufsize = getposint(OPT_ARG(ops, 's'), nam);
+	if (bufsize < 0)
+	    return 1;
+	if (!bufsize)
+	    bufsize = 1;
+    }
+
+    /* -n: maximum number of elements, else all */
+    if (OPT_ISSET(ops, 'n')) {
+	maxcount = getposint(OPT_ARG(ops, 'n'), nam);
+	if (maxcount < 0)
+	    return 1;
+    }
+
+    /* -k: number of elements to skip first */
+    if (OPT_ISSET(ops, 'k')) {
+	skip = getposint(OPT_ARG(ops, 'k'), nam);
+	if (skip < 0)
+	    return 1;
+    }
+
+    /* -d: delimiter if not newline; empty means a null byte */
+    if (OPT_ISSET(ops, 'd')) {
+	char *dstr = dupstring(OPT_ARG(ops, 'd'));
+	int dlen;
+
+	unmetafy(dstr, &dlen);
+	if (dlen > 1) {
+	    zwarnnam(nam, "delimiter must be a single byte: %s",
+		     OPT_ARG(ops, 'd'));
+	    return 1;
+	}
+	delim = *dstr;
+    }
+
+    /*
+     * Elements are split off directly from the input buffer.
+     * start is the beginning of the element being read, scan where
+     * to look for the next delimiter, end the end of the input.
+     * The buffer only grows if a single element doesn't fit.
+     */
+    buf = (char *)zalloc(bufsize);
+    arr = (char **)zalloc((aelts = 64) * sizeof(char *));
+    start = scan = end = total = nelts = 0;
+    for (;;) {
+	while (scan < end &&
+	       (dptr = (char *)memchr(buf + scan, delim, end - scan))) {
+	    if (skip)
+		skip--;
+	    else {
+		if (nelts + 1 == aelts)
+		    arr = (char **)zrealloc(arr,
+					    (aelts *= 2) * sizeof(char *));
+		arr[nelts++] = metafy(buf + start, dptr - buf - start,
+				      META_DUP);
+	    }
+	    start = scan = dptr - buf + 1;
+	    if (maxcount && nelts == maxcount)
+		break;
+	}
+	if (maxcount && nelts == maxcount)
+	    break;
+	scan = end;
+	if (end == bufsize) {
+	    if (start) {
+		memmove(buf, buf + start, end - start);
+		end -= start;
+		scan -= start;
+		start = 0;
+	    } else
+		buf = (char *)zrealloc(buf, bufsize *= 2);
+	}
+	while ((count = read(infd, buf + end, bufsize - end)) < 0) {
+	    if (errno != EINTR || errflag || retflag || breaks || contflag)
+		break;
+	}
+	if (count < 0) {
+	    /* freearray() frees the array by its length, so trim it */
+	    arr = (char **)zrealloc(arr, (nelts + 1) * sizeof(char *));
+	    arr[nelts] = NULL;
+	    freearray(arr);
+	    zfree(buf, bufsize);
+	    return 2;
+	}
+	if (!count) {
+	    /* last element needn't be terminated */
+	    if (start < end && !skip) {
+		if (nelts + 1 == aelts)
+		    arr = (char **)zrealloc(arr,
+					    (aelts *= 2) * sizeof(char *));
+		arr[nelts++] = metafy(buf + start, end - start, META_DUP);
+	    }
+	    start = end;
+	    break;
+	}
+	end += count;
+	total += count;
+    }
+    /*
+     * If we stopped early, put back what we didn't use if we can,
+     * so the rest of a file is there for the next reader.
+     */
+    if (start < end) {
+	struct stat st;
+
+	if (!fstat(infd, &st) && S_ISREG(st.st_mode))
+	    lseek(infd, (off_t)(start - end), SEEK_CUR);
+    }
+    zfree(buf, bufsize);
+
+    /* Trim the array to its length, as the parameter code expects. */
+    arr = (char **)zrealloc(arr, (nelts + 1) * sizeof(char *));
+    arr[nelts] = NULL;
+    setaparam(*args, arr);
+
+    return total ? 0 : 5;
+}
+
+
 /*
  * Return values of bin_syswrite:
  *	0	Successfully written
@@ -541,6 +691,7 @@ bin_zsystem(char *nam, char **args, Options ops, int func)
 static struct builtin bintab[] = {
     BUILTIN("syserror", 0, bin_syserror, 0, 1, 0, "e:p:", NULL),
     BUILTIN("sysread", 0, bin_sysread, 0, 1, 0, "c:i:o:s:t:", NULL),
+    BUILTIN("sysreadarray", 0, bin_sysreadarray, 1, 1, 0, "d:i:k:n:s:", NULL),
     BUILTIN("syswrite", 0, bin_syswrite, 1, 1, 0, "c:o:", NULL),
     BUILTIN("zsystem", 0, bin_zsystem, 1, -1, 0, NULL, NULL)
 };
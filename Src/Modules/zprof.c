@@ -33,43 +33,94 @@
 #include <sys/time.h>
 #include <unistd.h>
 
+/*
+ * Times are in milliseconds.  For each function and arc the wall clock
+ * time is kept together with the processor time used by the shell
+ * itself; the difference is time spent waiting, mostly for child
+ * processes.
+ */
+
+typedef struct parc *Parc;
 typedef struct pfunc *Pfunc;
 
 struct pfunc {
     Pfunc next;
+    Pfunc hnext;		/* next in hash chain */
     char *name;
+    char *file;			/* file function was defined in, if known */
+    Parc arcs;			/* arcs to functions called from this one */
     long calls;
     double time;
     double self;
+    double selfcpu;
     long num;
 };
 
 typedef struct sfunc *Sfunc;
 
 struct sfunc {
-    Pfunc p;
+    Pfunc p;			/* NULL if the profile was reset meanwhile */
+    Parc a;			/* arc from the caller, if any */
     Sfunc prev;
     double beg;
+    double cpubeg;
 };
 
-typedef struct parc *Parc;
-
 struct parc {
     Parc next;
+    Parc fnext;			/* next arc from the same function */
     Pfunc from;
     Pfunc to;
     long calls;
     double time;
     double self;
+    double cpu;
 };
 
+#define PFUNC_HASHSIZE 257
+
 static Pfunc calls;
 static int ncalls;
+static Pfunc pfunctab[PFUNC_HASHSIZE];
 static Parc arcs;
 static int narcs;
 static Sfunc stack;
 static Module zprof_module;
 
+/*
+ * Return the wall clock time from a monotonic clock where available and
+ * set *cpu to the processor time used by the shell.
+ */
+
+static double
+zproftime(double *cpu)
+{
+#ifdef HAVE_CLOCK_GETTIME
+    struct timespec ts;
+
+# ifdef CLOCK_PROCESS_CPUTIME_ID
+    if (!clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts))
+	*cpu = ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+    else
+# endif
+	*cpu = clock() * 1000.0 / CLOCKS_PER_SEC;
+# ifdef CLOCK_MONOTONIC
+    if (!clock_gettime(CLOCK_MONOTONIC, &ts))
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+# endif
+#else
+    *cpu = clock() * 1000.0 / CLOCKS_PER_SEC;
+#endif
+    {
+	struct timeval tv;
+	struct timezone dummy;
+
+	tv.tv_sec = tv.tv_usec = 0;
+	gettimeofday(&tv, &dummy);
+	return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+    }
+}
+
 static void
 freepfuncs(Pfunc f)
 {
@@ -78,8 +129,10 @@ freepfuncs(Pfunc f)
     for (; f; f = n) {
 	n = f->next;
 	zsfree(f->name);
+	zsfree(f->file);
 	zfree(f, sizeof(*f));
     }
+    memset(pfunctab, 0, sizeof(pfunctab));
 }
 
 static void
@@ -94,11 +147,12 @@ freeparcs(Parc a)
 }
 
 static Pfunc
-findpfunc(char *name)
+findpfunc(char *name, Pfunc **slot)
 {
     Pfunc f;
 
-    for (f = calls; f; f = f->next)
+    *slot = pfunctab + hasher(name) % PFUNC_HASHSIZE;
+    for (f = **slot; f; f = f->hnext)
 	if (!strcmp(name, f->name))
 	    return f;
 
@@ -110,13 +164,59 @@ findparc(Pfunc f, Pfunc t)
 {
     Parc a;
 
-    for (a = arcs; a; a = a->next)
-	if (a->from == f && a->to == t)
+    for (a = f->arcs; a; a = a->fnext)
+	if (a->to == t)
 	    return a;
 
     return NULL;
 }
 
+/*
+ * Time waiting in microseconds; the clocks' resolutions differ, so this
+ * can come out slightly negative.
+ */
+
+static double
+zprofwait(double wall, double cpu)
+{
+    return wall > cpu ? (wall - cpu) * 1000.0 : 0.0;
+}
+
+/* Print the profile in the format of callgrind, with times in microseconds. */
+
+static void
+zprofcallgrind(void)
+{
+    Pfunc f;
+    Parc a;
+    double self = 0.0, selfcpu = 0.0;
+
+    for (f = calls; f; f = f->next) {
+	self += f->self;
+	selfcpu += f->selfcpu;
+    }
+    printf("# callgrind format\nversion: 1\ncreator: zsh zprof\n");
+    printf("positions: line\nevents: Wall CPU Wait\n");
+    printf("event: Wall : wall clock time (us)\n");
+    printf("event: CPU : shell processor time (us)\n");
+    printf("event: Wait : time waiting, mostly for children (us)\n");
+    printf("summary: %.0f %.0f %.0f\n", self * 1000.0, selfcpu * 1000.0,
+	   zprofwait(self, selfcpu));
+    for (f = calls; f; f = f->next) {
+	printf("\nfl=%s\nfn=%s\n0 %.0f %.0f %.0f\n",
+	       f->file ? f->file : "???", f->name,
+	       f->self * 1000.0, f->selfcpu * 1000.0,
+	       zprofwait(f->self, f->selfcpu));
+	for (a = f->arcs; a; a = a->fnext) {
+	    if (a->to->file)
+		printf("cfl=%s\n", a->to->file);
+	    printf("cfn=%s\ncalls=%ld 0\n0 %.0f %.0f %.0f\n",
+		   a->to->name, a->calls, a->time * 1000.0, a->cpu * 1000.0,
+		   zprofwait(a->time, a->cpu));
+	}
+    }
+}
+
 static int
 cmpsfuncs(Pfunc *a, Pfunc *b)
 {
@@ -139,12 +239,18 @@ static int
 bin_zprof(UNUSED(char *nam), UNUSED(char **args), Options ops, UNUSED(int func))
 {
     if (OPT_ISSET(ops,'c')) {
+	Sfunc sp;
+
+	for (sp = stack; sp; sp = sp->prev)
+	    sp->p = NULL, sp->a = NULL;
 	freepfuncs(calls);
 	calls = NULL;
 	ncalls = 0;
 	freeparcs(arcs);
 	arcs = NULL;
 	narcs = 0;
+    } else if (OPT_ISSET(ops,'g')) {
+	zprofcallgrind();
     } else {
 	VARARR(Pfunc, fs, (ncalls + 1));
 	Pfunc f, *fp;
@@ -219,57 +325,63 @@ zprof_wrapper(Eprog prog, FuncWrap w, char *name)
 {
     int active = 0;
     struct sfunc sf, *sp;
-    Pfunc f = NULL;
+    Pfunc f = NULL, *slot;
     Parc a = NULL;
-    struct timeval tv;
-    struct timezone dummy;
-    double prev = 0, now;
+    double prev = 0, now, prevcpu = 0, nowcpu;
 
     if (zprof_module && !(zprof_module->node.flags & MOD_UNLOAD)) {
         active = 1;
-        if (!(f = findpfunc(name))) {
+        if (!(f = findpfunc(name, &slot))) {
             f = (Pfunc) zalloc(sizeof(*f));
             f->name = ztrdup(name);
+            f->file = (funcstack && funcstack->filename) ?
+                ztrdup(funcstack->filename) : NULL;
+            f->arcs = NULL;
             f->calls = 0;
-            f->time = f->self = 0.0;
+            f->time = f->self = f->selfcpu = 0.0;
             f->next = calls;
             calls = f;
+            f->hnext = *slot;
+            *slot = f;
             ncalls++;
         }
-        if (stack) {
+        if (stack && stack->p) {
             if (!(a = findparc(stack->p, f))) {
                 a = (Parc) zalloc(sizeof(*a));
                 a->from = stack->p;
                 a->to = f;
                 a->calls = 0;
-                a->time = a->self = 0.0;
+                a->time = a->self = a->cpu = 0.0;
                 a->next = arcs;
                 arcs = a;
+                a->fnext = stack->p->arcs;
+                stack->p->arcs = a;
                 narcs++;
             }
         }
         sf.prev = stack;
         sf.p = f;
+        sf.a = a;
         stack = &sf;
 
         f->calls++;
-        tv.tv_sec = tv.tv_usec = 0;
-        gettimeofday(&tv, &dummy);
-        sf.beg = prev = ((((double) tv.tv_sec) * 1000.0) +
-                         (((double) tv.tv_usec) / 1000.0));
+        sf.beg = prev = zproftime(&prevcpu);
+        sf.cpubeg = prevcpu;
     }
     runshfunc(prog, w, name);
     if (active) {
         if (zprof_module && !(zprof_module->node.flags & MOD_UNLOAD)) {
-            tv.tv_sec = tv.tv_usec = 0;
-            gettimeofday(&tv, &dummy);
-
-            now = ((((double) tv.tv_sec) * 1000.0) +
-                   (((double) tv.tv_usec) / 1000.0));
-            f->self += now - sf.beg;
-            for (sp = sf.prev; sp && sp->p != f; sp = sp->prev);
-            if (!sp)
-                f->time += now - prev;
+            now = zproftime(&nowcpu);
+            /* The records may have been freed by zprof -c. */
+            f = sf.p;
+            a = sf.a;
+            if (f) {
+                f->self += now - sf.beg;
+                f->selfcpu += nowcpu - sf.cpubeg;
+                for (sp = sf.prev; sp && sp->p != f; sp = sp->prev);
+                if (!sp)
+                    f->time += now - prev;
+            }
             if (a) {
                 a->calls++;
                 a->self += now - sf.beg;
@@ -278,8 +390,11 @@ zprof_wrapper(Eprog prog, FuncWrap w, char *name)
 
             if (stack) {
                 stack->beg += now - prev;
-                if (a)
+                stack->cpubeg += nowcpu - prevcpu;
+                if (a) {
                     a->time += now - prev;
+                    a->cpu += nowcpu - prevcpu;
+                }
             }
         } else
             stack = sf.prev;
@@ -288,7 +403,7 @@ zprof_wrapper(Eprog prog, FuncWrap w, char *name)
 }
 
 static struct builtin bintab[] = {
-    BUILTIN("zprof", 0, bin_zprof, 0, 0, 0, "c", NULL),
+    BUILTIN("zprof", 0, bin_zprof, 0, 0, 0, "cg", NULL),
 };
 
 static struct funcwrap wrapper[] = {
@@ -332,6 +447,7 @@ boot_(Module m)
 {
     calls = NULL;
     ncalls = 0;
+    memset(pfunctab, 0, sizeof(pfunctab));
     arcs = NULL;
     narcs = 0;
     stack = NULL;
@@ -30,6 +30,13 @@
 #include "zpty.mdh"
 #include "zpty.pro"
 
+#ifdef HAVE_POLL_H
+# include <poll.h>
+#endif
+#if defined(HAVE_POLL) && !defined(POLLIN) && !defined(POLLNORM)
+# undef HAVE_POLL
+#endif
+
 /* The number of bytes we normally read when given no pattern and the
  * upper bound on the number of bytes we read (even if we are give a
  * pattern). */
@@ -479,6 +486,8 @@ deleteptycmd(Ptycmd cmd)
 
     zsfree(p->name);
     freearray(p->args);
+    if (p->old)
+	zfree(p->old, p->olen);
 
     zclose(cmd->fd);
 
@@ -520,12 +529,117 @@ checkptycmd(Ptycmd cmd)
     cmd->read = (int) c;
 }
 
+/*
+ * Wait until there is output to read from the pty, or the deadline,
+ * if any, passes.  Return 1 if there is output, 0 on timeout, or -1
+ * if we can't tell.
+ */
+
+static int
+ptywait(Ptycmd cmd, struct timeval *deadline)
+{
+#if defined(HAVE_POLL) || defined(HAVE_SELECT)
+    int ret;
+
+    do {
+	long left = -1;
+
+	if (deadline) {
+	    struct timeval now;
+
+	    gettimeofday(&now, NULL);
+	    left = (deadline->tv_sec - now.tv_sec) * 1000000L +
+		(deadline->tv_usec - now.tv_usec);
+	    if (left < 0)
+		left = 0;
+	}
+# ifdef HAVE_POLL
+	{
+	    struct pollfd pfd;
+
+	    pfd.fd = cmd->fd;
+	    pfd.events = POLLIN;
+	    pfd.revents = 0;
+	    ret = poll(&pfd, 1, left < 0 ? -1 : (int)((left + 999) / 1000));
+	}
+# else
+	{
+	    fd_set foofd;
+	    struct timeval expire_tv;
+
+	    expire_tv.tv_sec = left / 1000000L;
+	    expire_tv.tv_usec = left % 1000000L;
+	    FD_ZERO(&foofd);
+	    FD_SET(cmd->fd, &foofd);
+	    ret = select(cmd->fd+1, (SELECT_ARG_2_T) &foofd, NULL, NULL,
+			 left < 0 ? NULL : &expire_tv);
+	}
+# endif
+    } while (ret < 0 && errno == EINTR && !errflag);
+
+    return ret < 0 ? -1 : ret > 0;
+#else
+# ifdef FIONREAD
+    int val;
+
+    if (ioctl(cmd->fd, FIONREAD, (char *) &val) == 0)
+	return (val > 0);
+# endif
+    return -1;
+#endif
+}
+
+/*
+ * Find the shortest leading part of buf that matches prog and ends
+ * at or after position from.  Shorter ones have already been tried.
+ * Return its length, or 0 if there is none.
+ *
+ * If we have anyprog, which is `(prog)*', that matches any string with
+ * a leading part matching prog, so only the whole buffer needs trying to
+ * find out if there is a match, and the shortest can be found by
+ * bisection.  Otherwise we try each new end position in turn.
+ */
+
+static int
+ptymatch(Patprog prog, Patprog anyprog, char *buf, int from, int used)
+{
+    int mid;
+
+    if (from < 1)
+	from = 1;
+    if (anyprog) {
+	if (from > used || !pattrylen(anyprog, buf, used, -1, 0))
+	    return 0;
+	while (from < used) {
+	    mid = from + (used - from) / 2;
+	    if (pattrylen(anyprog, buf, mid, -1, 0))
+		used = mid;
+	    else
+		from = mid + 1;
+	}
+	return used;
+    }
+    for (; from <= used; from++)
+	if (pattrylen(prog, buf, from, -1, 0))
+	    return from;
+    return 0;
+}
+
+/*
+ * Read from the pty.  Output is read in blocks; anything beyond the
+ * line or the match wanted is kept in cmd->old for the next read.
+ * timeout is in microseconds; if it is non-negative we only wait that
+ * long for output, else we block.
+ */
+
 static int
-ptyread(char *nam, Ptycmd cmd, char **args, int noblock, int mustmatch)
+ptyread(char *nam, Ptycmd cmd, char **args, zlong timeout, int mustmatch)
 {
-    int blen, used, seen = 0, ret = 0, matchok = 0;
+    int blen, used, tested = 0, seen, ret = 0, matchok = 0;
+    int outlen = -1;
     char *buf;
-    Patprog prog = NULL;
+    Patprog prog = NULL, anyprog = NULL;
+    struct timeval deadline;
 
     if (*args && args[1]) {
 	char *p;
@@ -541,48 +655,67 @@ ptyread(char *nam, Ptycmd cmd, char **args, int noblock, int mustmatch)
 	    zwarnnam(nam, "bad pattern: %s", args[1]);
 	    return 1;
 	}
+	/*
+	 * Grouping isn't available with SH_GLOB, and a top-level
+	 * exclusion can't be put inside a group.
+	 */
+	if (!isset(SHGLOB) && !zpc_disables[ZPC_INPAR] && !strchr(p, Tilde)) {
+	    char *anyp = zhalloc(strlen(p) + 4);
+
+	    sprintf(anyp, "%c%s%c%c", Inpar, p, Outpar, Star);
+	    anyprog = patcompile(anyp, 0, NULL);
+	}
     } else
 	fflush(stdout);
 
     if (cmd->old) {
 	used = cmd->olen;
-	buf = (char *) zhalloc((blen = 256 + used) + 1);
+	buf = (char *) zhalloc((blen = BUFSIZ + used) + 1);
 	memcpy(buf, cmd->old, cmd->olen);
 	zfree(cmd->old, cmd->olen);
 	cmd->old = NULL;
 	cmd->olen = 0;
     } else {
 	used = 0;
-	buf = (char *) zhalloc((blen = 256) + 1);
+	buf = (char *) zhalloc((blen = BUFSIZ) + 1);
     }
     if (cmd->read != -1) {
-	buf[used] = (char) cmd->read;
-	buf[used + 1] = '\0';
-	seen = used = 1;
+	buf[used++] = (char) cmd->read;
 	cmd->read = -1;
     }
-    do {
-	if (noblock && cmd->read == -1) {
-	    int pollret;
-	    /*
-	     * Check there is data available.  Borrowed from
-	     * poll_read() in utils.c and simplified.
-	     */
-#ifdef HAVE_SELECT
-	    fd_set foofd;
-	    struct timeval expire_tv;
-	    expire_tv.tv_sec = 0;
-	    expire_tv.tv_usec = 0;
-	    FD_ZERO(&foofd);
-	    FD_SET(cmd->fd, &foofd);
-	    pollret = select(cmd->fd+1,
-			 (SELECT_ARG_2_T) &foofd, NULL, NULL, &expire_tv);
-#else
-#ifdef FIONREAD
-	    if (ioctl(cmd->fd, FIONREAD, (char *) &val) == 0)
-		pollret = (val > 0);
-#endif
-#endif
+    seen = (used > 0);
+    if (timeout >= 0) {
+	gettimeofday(&deadline, NULL);
+	deadline.tv_sec += (long)(timeout / 1000000);
+	deadline.tv_usec += (long)(timeout % 1000000);
+	if (deadline.tv_usec >= 1000000L) {
+	    deadline.tv_sec++;
+	    deadline.tv_usec -= 1000000L;
+	}
+    }
+
+    for (;;) {
+	/* Look for the end of what we want in the new output only. */
+	buf[used] = '\0';
+	if (prog) {
+	    if ((outlen = ptymatch(prog, anyprog, buf, tested + 1, used))) {
+		matchok = 1;
+		break;
+	    }
+	} else if (*args) {
+	    char *nl = memchr(buf + tested, '\n', used - tested);
+	    if (nl) {
+		outlen = nl - buf + 1;
+		break;
+	    }
+	}
+	tested = used;
+
+	if (errflag || breaks || retflag || contflag || used >= READ_MAX ||
+	    cmd->fin)
+	    break;
+	if (timeout >= 0 && cmd->read == -1) {
+	    int pollret = ptywait(cmd, &deadline);
 
 	    if (pollret < 0) {
 		/*
@@ -592,9 +725,14 @@ ptyread(char *nam, Ptycmd cmd, char **args, int noblock, int mustmatch)
 		 * character.  cmd->read stores the character read.
 		 */
 		long mode;
+		char c;
 
-		if (setblock_fd(0, cmd->fd, &mode))
-		    pollret = read(cmd->fd, &cmd->read, 1);
+		pollret = 0;
+		if (setblock_fd(0, cmd->fd, &mode) &&
+		    read(cmd->fd, &c, 1) == 1) {
+		    cmd->read = (int) c;
+		    pollret = 1;
+		}
 		if (mode != -1)
 		    fcntl(cmd->fd, F_SETFL, mode);
 	    }
@@ -606,58 +744,53 @@ ptyread(char *nam, Ptycmd cmd, char **args, int noblock, int mustmatch)
 	    if (cmd->fin)
 		break;
 	}
-	if (cmd->read != -1 || (ret = read(cmd->fd, buf + used, 1)) == 1) {
-	    if (cmd->read != -1) {
-		ret = 1;
-		buf[used] = (char) cmd->read;
-		cmd->read = -1;
-	    }
-	    seen = 1;
-	    if (++used == blen) {
-		if (!*args) {
-		    write_loop(1, buf, used);
-		    used = 0;
-		} else {
-		    buf = hrealloc(buf, blen, blen << 1);
-		    blen <<= 1;
-		}
+	if (blen - used < 256) {
+	    if (!*args) {
+		write_loop(1, buf, used);
+		used = tested = 0;
+	    } else {
+		buf = hrealloc(buf, blen + 1, (blen << 1) + 1);
+		blen <<= 1;
 	    }
 	}
-	buf[used] = '\0';
-
-	if (!prog) {
-	    if (ret <= 0 || (*args && buf[used - 1] == '\n'))
-		break;
-	} else {
-	    if (ret < 0
+	if (cmd->read != -1) {
+	    ret = 1;
+	    buf[used++] = (char) cmd->read;
+	    cmd->read = -1;
+	    seen = 1;
+	} else if ((ret = read(cmd->fd, buf + used, blen - used)) > 0) {
+	    used += ret;
+	    seen = 1;
+	} else if (!prog) {
+	    break;
+	} else if (ret < 0) {
 #ifdef EWOULDBLOCK
-		&& errno != EWOULDBLOCK
+	    if (errno != EWOULDBLOCK)
+		break;
 #else
 #ifdef EAGAIN
-		&& errno != EAGAIN
+	    if (errno != EAGAIN)
+		break;
 #endif
 #endif
-		)
-		break;
+	    /* Non-blocking and we need more: wait for it. */
+	    if (timeout < 0)
+		ptywait(cmd, NULL);
 	}
-    } while (!(errflag || breaks || retflag || contflag) &&
-	     used < READ_MAX &&
-	     !(prog && ret && (matchok = pattry(prog, buf))));
+    }
 
-    if (prog && ret < 0 &&
-#ifdef EWOULDBLOCK
-	errno == EWOULDBLOCK
-#else
-#ifdef EAGAIN
-	errno == EAGAIN
-#endif
-#endif
-	) {
+    if (prog && !matchok && mustmatch && !cmd->fin && used < READ_MAX) {
+	/* Keep what we've read for another try. */
 	cmd->old = (char *) zalloc(cmd->olen = used);
 	memcpy(cmd->old, buf, cmd->olen);
 
 	return 1;
     }
+    if (outlen >= 0 && outlen < used) {
+	cmd->old = (char *) zalloc(cmd->olen = used - outlen);
+	memcpy(cmd->old, buf + outlen, cmd->olen);
+	used = outlen;
+    }
     if (*args)
 	setsparam(*args, ztrdup(metafy(buf, used, META_HREALLOC)));
     else if (used)
@@ -757,13 +890,28 @@ bin_zpty(char *nam, char **args, Options ops, UNUSED(int func))
 	    zwarnnam(nam, "no such pty command: %s", *args);
 	    return 1;
 	}
-	if (p->fin)
+	if (p->fin && !(OPT_ISSET(ops,'r') && p->old))
 	    return 2;
 
-	return (OPT_ISSET(ops,'r') ?
-		ptyread(nam, p, args + 1, OPT_ISSET(ops,'t'),
-			OPT_ISSET(ops, 'm')) :
-		ptywrite(p, args + 1, OPT_ISSET(ops,'n')));
+	if (OPT_ISSET(ops,'r')) {
+	    zlong timeout = -1;
+
+	    if (OPT_HASARG(ops,'t')) {
+		mnumber mn = matheval(OPT_ARG(ops,'t'));
+
+		if (errflag)
+		    return 1;
+		if (mn.type == MN_FLOAT)
+		    timeout = (zlong)(mn.u.d * 1e6);
+		else
+		    timeout = (zlong)mn.u.l * (zlong)1000000;
+		if (timeout < 0)
+		    timeout = 0;
+	    } else if (OPT_ISSET(ops,'t'))
+		timeout = 0;
+	    return ptyread(nam, p, args + 1, timeout, OPT_ISSET(ops, 'm'));
+	}
+	return ptywrite(p, args + 1, OPT_ISSET(ops,'n'));
     } else if (OPT_ISSET(ops,'d')) {
 	Ptycmd p;
 	int ret = 0;
@@ -836,7 +984,7 @@ ptyhook(UNUSED(Hookdef d), UNUSED(void *dummy))
 
 
 static struct builtin bintab[] = {
-    BUILTIN("zpty", 0, bin_zpty, 0, -1, 0, "ebdmrwLnt", NULL),
+    BUILTIN("zpty", 0, bin_zpty, 0, -1, 0, "ebdmrwLnt:%", NULL),
 };
 
 static struct features module_features = {
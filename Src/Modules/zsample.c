@@ -0,0 +1,487 @@
+/*
+ * zsample.c - sampling profiler for shell code
+ *
+ * This file is part of zsh, the Z shell.
+ *
+ * Copyright (c) 2013 Zsh Development Group
+ * All rights reserved.
+ *
+ * Permission is hereby granted, without written agreement and without
+ * license or royalty fees, to use, copy, modify, and distribute this
+ * software and to distribute modified versions of this software for any
+ * purpose, provided that the above copyright notice and the following
+ * two paragraphs appear in all copies of this software.
+ *
+ * In no event shall the Zsh Development Group be liable to any party
+ * for direct, indirect, special, incidental, or consequential damages
+ * arising out of the use of this software and its documentation, even
+ * if the Zsh Development Group have been advised of the possibility of
+ * such damage.
+ *
+ * The Zsh Development Group specifically disclaim any warranties,
+ * including, but not limited to, the implied warranties of
+ * merchantability and fitness for a particular purpose.  The software
+ * provided hereunder is on an "as is" basis, and the Zsh Development
+ * Group have no obligation to provide maintenance, support, updates,
+ * enhancements, or modifications.
+ *
+ */
+
+#include "zsample.mdh"
+#include "zsample.pro"
+
+#include <sys/time.h>
+
+/*
+ * While sampling, SIGPROF arrives at regular intervals of the CPU time
+ * used by the shell and the handler records the stack of functions and
+ * sourced files being executed, together with the line executing in
+ * each.  The handler can't allocate memory, so everything it uses is
+ * allocated when sampling starts: the names of frames are kept once
+ * each in a pool, and the stacks form a tree in which each node is
+ * identified by its parent, its name and its line and counts the samples
+ * in which it was the innermost frame.  Both are found by hashing with
+ * open addressing.
+ */
+
+/* Deepest stack recorded; deeper stacks lose their outermost frames. */
+#define ZS_MAXDEPTH	64
+/* Longest name recorded for a frame. */
+#define ZS_MAXNAME	255
+/* Size of the pool of names and of its hash table. */
+#define ZS_POOLSIZE	(128 * 1024)
+#define ZS_NAMEHASH	8192
+/* Number of nodes and size of their hash table. */
+#define ZS_NODES	32768
+#define ZS_NODEHASH	(2 * ZS_NODES)
+/* Default and maximum rate in samples per second. */
+#define ZS_RATE		1000
+#define ZS_MAXRATE	10000
+
+typedef struct zsnode *Zsnode;
+
+struct zsnode {
+    int parent;			/* index of parent node, -1 for the root */
+    int name;			/* offset of name in zspool, -1 if unknown */
+    zlong line;			/* line executing in this frame */
+    long count;			/* samples with this the innermost frame */
+};
+
+static char *zspool;
+static int zspoolused, zsnnames;
+static int *zsnamehash;
+static Zsnode zsnodes;
+static int zsnnodes;
+static int *zsnodehash;
+/* Samples taken and those lost because the tables were full. */
+static long zssamples, zsdropped;
+static int zsrunning;
+
+#ifdef POSIX_SIGNALS
+static struct sigaction zsoldact;
+#else
+static RETSIGTYPE (*zsoldhandler) _((int));
+#endif
+
+/* Find the name in the pool, adding it if necessary. */
+
+static int
+zsintern(const char *name)
+{
+    const char *s;
+    unsigned int h = 2166136261U;
+    int len, slot, off;
+
+    for (s = name, len = 0; *s && len < ZS_MAXNAME; s++, len++)
+	h = (h ^ (unsigned char) *s) * 16777619U;
+    for (slot = h % ZS_NAMEHASH; (off = zsnamehash[slot]); ) {
+	if (!strncmp(zspool + off - 1, name, len) && !zspool[off - 1 + len])
+	    return off - 1;
+	if (++slot == ZS_NAMEHASH)
+	    slot = 0;
+    }
+    if (zspoolused + len + 1 > ZS_POOLSIZE || zsnnames == ZS_NAMEHASH / 2)
+	return -1;
+    zsnnames++;
+    off = zspoolused;
+    /* Keep the collapsed stack format unambiguous. */
+    for (s = name; s < name + len; s++)
+	zspool[zspoolused++] = (*s == ';' || *s == '\n' || *s == ' ') ?
+	    '_' : *s;
+    zspool[zspoolused++] = '\0';
+    zsnamehash[slot] = off + 1;
+    return off;
+}
+
+/* Find the node for a frame, adding it if necessary. */
+
+static int
+zsfindnode(int parent, int name, zlong line)
+{
+    unsigned int h;
+    int slot, n;
+
+    h = ((unsigned int) parent * 31U + (unsigned int) name) * 2654435761U
+	^ (unsigned int) line;
+    for (slot = h % ZS_NODEHASH; (n = zsnodehash[slot]); ) {
+	Zsnode zn = zsnodes + n - 1;
+
+	if (zn->parent == parent && zn->name == name && zn->line == line)
+	    return n - 1;
+	if (++slot == ZS_NODEHASH)
+	    slot = 0;
+    }
+    if (zsnnodes == ZS_NODES)
+	return -1;
+    n = zsnnodes++;
+    zsnodes[n].parent = parent;
+    zsnodes[n].name = name;
+    zsnodes[n].line = line;
+    zsnodes[n].count = 0;
+    zsnodehash[slot] = n + 1;
+    return n;
+}
+
+static RETSIGTYPE
+zsample_handler(UNUSED(int sig))
+{
+    Funcstack frames[ZS_MAXDEPTH - 1], fs;
+    int depth = 0, node, i, errsave = errno;
+
+    for (fs = funcstack; fs && depth < ZS_MAXDEPTH - 1; fs = fs->prev)
+	frames[depth++] = fs;
+    /*
+     * The line in each frame is where it called the next one in,
+     * which recorded it on entry, or the current line.
+     */
+    node = zsfindnode(-1, zsintern(depth ? frames[depth - 1]->caller :
+				   argzero ? argzero : "zsh"),
+		      depth ? frames[depth - 1]->lineno : lineno);
+    for (i = depth - 1; node >= 0 && i >= 0; i--)
+	node = zsfindnode(node, zsintern(frames[i]->name),
+			  i ? frames[i - 1]->lineno : lineno);
+    if (node >= 0)
+	zsnodes[node].count++;
+    else
+	zsdropped++;
+    zssamples++;
+    errno = errsave;
+}
+
+/* Empty the tables, which must already be allocated. */
+
+static void
+zsreset(void)
+{
+    zspoolused = zsnnames = 0;
+    memset(zsnamehash, 0, ZS_NAMEHASH * sizeof(int));
+    zsnnodes = 0;
+    memset(zsnodehash, 0, ZS_NODEHASH * sizeof(int));
+    zssamples = zsdropped = 0;
+}
+
+static void
+zsfreetables(void)
+{
+    if (zsnodes) {
+	zfree(zspool, ZS_POOLSIZE);
+	zfree(zsnamehash, ZS_NAMEHASH * sizeof(int));
+	zfree(zsnodes, ZS_NODES * sizeof(struct zsnode));
+	zfree(zsnodehash, ZS_NODEHASH * sizeof(int));
+	zsnodes = NULL;
+    }
+}
+
+/* Install the handler for SIGPROF, saving the old action. */
+
+static void
+zssethandler(void)
+{
+#ifdef POSIX_SIGNALS
+    struct sigaction act;
+
+    act.sa_handler = (SIGNAL_HANDTYPE) zsample_handler;
+    sigemptyset(&act.sa_mask);
+    act.sa_flags = SA_RESTART;
+    sigaction(SIGPROF, &act, &zsoldact);
+#else
+    zsoldhandler = signal(SIGPROF, zsample_handler);
+#endif
+}
+
+/* Put back the action for SIGPROF saved by zssethandler(). */
+
+static void
+zsresethandler(void)
+{
+#ifdef POSIX_SIGNALS
+    sigaction(SIGPROF, &zsoldact, NULL);
+#else
+    signal(SIGPROF, zsoldhandler);
+#endif
+}
+
+static int
+zsstart(char *nam, long rate)
+{
+    struct itimerval it;
+    long usec = 1000000 / rate;
+
+    if (sigtrapped[SIGPROF]) {
+	zwarnnam(nam, "can't sample while SIGPROF is trapped");
+	return 1;
+    }
+    if (!zsnodes) {
+	zspool = (char *) zalloc(ZS_POOLSIZE);
+	zsnamehash = (int *) zalloc(ZS_NAMEHASH * sizeof(int));
+	zsnodes = (Zsnode) zalloc(ZS_NODES * sizeof(struct zsnode));
+	zsnodehash = (int *) zalloc(ZS_NODEHASH * sizeof(int));
+	zsreset();
+    }
+    if (!zsrunning) {
+	zssethandler();
+	zsrunning = 1;
+    }
+    it.it_interval.tv_sec = usec / 1000000;
+    it.it_interval.tv_usec = usec % 1000000;
+    it.it_value = it.it_interval;
+    if (setitimer(ITIMER_PROF, &it, NULL)) {
+	zwarnnam(nam, "can't start timer: %e", errno);
+	return 1;
+    }
+    return 0;
+}
+
+static void
+zsstop(void)
+{
+    struct itimerval it;
+
+    if (!zsrunning)
+	return;
+    memset(&it, 0, sizeof(it));
+    setitimer(ITIMER_PROF, &it, NULL);
+    zsresethandler();
+    zsrunning = 0;
+}
+
+/*
+ * The profiling timer stays armed across execve() while the new program
+ * gets the default action for SIGPROF, which would kill it.  So stop the
+ * timer and put back the old action before the shell itself execs, and
+ * start them again if that fails.  A forked child doesn't inherit the
+ * timer, so has nothing to do.
+ */
+
+static struct itimerval zsexecit;
+static int zsexecstopped;
+
+static int
+zsbeforeexec(UNUSED(Hookdef dummy), UNUSED(void *dat))
+{
+    struct itimerval it;
+
+    if (!zsrunning || zsexecstopped)
+	return 0;
+    memset(&it, 0, sizeof(it));
+    if (setitimer(ITIMER_PROF, &it, &zsexecit) ||
+	(!zsexecit.it_value.tv_sec && !zsexecit.it_value.tv_usec))
+	return 0;
+    zsresethandler();
+    zsexecstopped = 1;
+    return 0;
+}
+
+static int
+zsafterexec(UNUSED(Hookdef dummy), UNUSED(void *dat))
+{
+    if (!zsexecstopped)
+	return 0;
+    zssethandler();
+    setitimer(ITIMER_PROF, &zsexecit, NULL);
+    zsexecstopped = 0;
+    return 0;
+}
+
+static char *
+zsname(int name)
+{
+    return name < 0 ? "?" : zspool + name;
+}
+
+/* Print the stacks sampled, one per line, with the number of samples. */
+
+static void
+zsprintstacks(void)
+{
+    int n, i, depth, chain[ZS_MAXDEPTH];
+
+    for (n = 0; n < zsnnodes; n++) {
+	if (!zsnodes[n].count)
+	    continue;
+	for (depth = 0, i = n; i >= 0 && depth < ZS_MAXDEPTH;
+	     i = zsnodes[i].parent)
+	    chain[depth++] = i;
+	while (depth--) {
+	    printf("%s:%ld%s", zsname(zsnodes[chain[depth]].name),
+		   (long) zsnodes[chain[depth]].line, depth ? ";" : "");
+	}
+	printf(" %ld\n", zsnodes[n].count);
+    }
+}
+
+static int
+cmpzsline(Zsnode *a, Zsnode *b)
+{
+    if ((*a)->name != (*b)->name)
+	return (*a)->name < (*b)->name ? -1 : 1;
+    if ((*a)->line != (*b)->line)
+	return (*a)->line < (*b)->line ? -1 : 1;
+    return 0;
+}
+
+static int
+cmpzscount(Zsnode *a, Zsnode *b)
+{
+    return ((*a)->count > (*b)->count ? -1 : ((*a)->count != (*b)->count));
+}
+
+/* Print the samples for each line, most frequent first. */
+
+static void
+zsprintlines(void)
+{
+    Zsnode *ns = (Zsnode *) zhalloc((zsnnodes + 1) * sizeof(Zsnode));
+    Zsnode totals = (Zsnode) zhalloc((zsnnodes + 1) * sizeof(struct zsnode));
+    Zsnode *np;
+    int n, nlines = 0;
+    long total = 0;
+
+    for (n = 0, np = ns; n < zsnnodes; n++)
+	if (zsnodes[n].count) {
+	    *np++ = zsnodes + n;
+	    total += zsnodes[n].count;
+	}
+    qsort(ns, np - ns, sizeof(Zsnode),
+	  (int (*) _((const void *, const void *))) cmpzsline);
+    for (n = 0; ns + n < np; n++) {
+	if (nlines && !cmpzsline(&ns[n], &ns[n - 1]))
+	    totals[nlines - 1].count += ns[n]->count;
+	else
+	    totals[nlines++] = *ns[n];
+    }
+    for (n = 0; n < nlines; n++)
+	ns[n] = totals + n;
+    qsort(ns, nlines, sizeof(Zsnode),
+	  (int (*) _((const void *, const void *))) cmpzscount);
+    printf("samples      %%  line\n");
+    for (n = 0; n < nlines; n++)
+	printf("%7ld %6.2f%%  %s:%ld\n", ns[n]->count,
+	       100.0 * ns[n]->count / total, zsname(ns[n]->name),
+	       (long) ns[n]->line);
+}
+
+static int
+bin_zsample(char *nam, UNUSED(char **args), Options ops, UNUSED(int func))
+{
+    if (OPT_ISSET(ops,'s')) {
+	long rate = ZS_RATE;
+
+	if (OPT_ISSET(ops,'r')) {
+	    char *eptr;
+
+	    rate = zstrtol(OPT_ARG(ops,'r'), &eptr, 10);
+	    if (*eptr || rate < 1 || rate > ZS_MAXRATE) {
+		zwarnnam(nam, "invalid rate: %s", OPT_ARG(ops,'r'));
+		return 1;
+	    }
+	}
+	return zsstart(nam, rate);
+    }
+    if (OPT_ISSET(ops,'x'))
+	zsstop();
+    if (OPT_ISSET(ops,'c')) {
+	if (zsnodes) {
+	    sigset_t set = signal_block(signal_mask(SIGPROF));
+
+	    zsreset();
+	    signal_setmask(set);
+	}
+    } else if (!OPT_ISSET(ops,'x') && zsnodes) {
+	sigset_t set = signal_block(signal_mask(SIGPROF));
+
+	if (OPT_ISSET(ops,'l'))
+	    zsprintlines();
+	else
+	    zsprintstacks();
+	fflush(stdout);
+	if (zsdropped)
+	    zwarnnam(nam, "%ld of %ld samples lost, tables full",
+		     zsdropped, zssamples);
+	signal_setmask(set);
+    }
+    return 0;
+}
+
+static struct builtin bintab[] = {
+    BUILTIN("zsample", 0, bin_zsample, 0, 0, 0, "clr:sx", NULL),
+};
+
+static struct features module_features = {
+    bintab, sizeof(bintab)/sizeof(*bintab),
+    NULL, 0,
+    NULL, 0,
+    NULL, 0,
+    0
+};
+
+/**/
+int
+setup_(UNUSED(Module m))
+{
+    return 0;
+}
+
+/**/
+int
+features_(Module m, char ***features)
+{
+    *features = featuresarray(m, &module_features);
+    return 0;
+}
+
+/**/
+int
+enables_(Module m, int **enables)
+{
+    return handlefeatures(m, &module_features, enables);
+}
+
+/**/
+int
+boot_(UNUSED(Module m))
+{
+    zsnodes = NULL;
+    zsrunning = zsexecstopped = 0;
+    addhookfunc("before_exec", zsbeforeexec);
+    addhookfunc("after_exec", zsafterexec);
+    return 0;
+}
+
+/**/
+int
+cleanup_(Module m)
+{
+    deletehookfunc("before_exec", zsbeforeexec);
+    deletehookfunc("after_exec", zsafterexec);
+    zsstop();
+    zsfreetables();
+    return setfeatureenables(m, &module_features, NULL);
+}
+
+/**/
+int
+finish_(UNUSED(Module m))
+{
+    return 0;
+}
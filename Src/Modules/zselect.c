@@ -30,14 +30,126 @@
 #include "zselect.mdh"
 #include "zselect.pro"
 
+/*
+ * poll() has no limit on the size of the file descriptors it handles,
+ * so we use it in preference to select() where it's available.  A
+ * persistent watch set (-W) is registered with epoll where that exists,
+ * so that waiting on the same large set repeatedly doesn't hand the
+ * whole set to the kernel each time.
+ */
+#ifdef HAVE_POLL_H
+# include <poll.h>
+#endif
+#if defined(HAVE_POLL) && !defined(POLLIN) && !defined(POLLNORM)
+# undef HAVE_POLL
+#endif
+#if defined(HAVE_SYS_EPOLL_H) && defined(HAVE_EPOLL_CREATE1)
+# include <sys/epoll.h>
+# define USE_EPOLL 1
+#endif
+
+/* Conditions to test; the order matches the letters "rwe". */
+#define ZSEL_READ	1
+#define ZSEL_WRITE	2
+#define ZSEL_EXCEPT	4
+/* Descriptor in a watch set that epoll can't handle. */
+#define ZSEL_NOEPOLL	8
+
+static const char fdchar[3] = "rwe";
+
+/* A file descriptor together with the ZSEL_* conditions for it. */
+
+struct selfd {
+    int fd;
+    int what;
+};
+
+/* A growable set of file descriptors. */
+
+struct selset {
+    struct selfd *fds;
+    int nfds, size;
+};
+
+#ifdef USE_EPOLL
+/*
+ * A watch set registered with epoll.  The parameter holding the
+ * set is the authority; reg records what the kernel was last told
+ * so that only changes need to be passed on.
+ */
+
+typedef struct watchset *Watchset;
+
+struct watchset {
+    Watchset next;
+    char *name;			/* Name of the parameter */
+    int epfd;			/* The epoll file descriptor */
+    pid_t pid;			/* Process that created epfd */
+    struct selset reg;		/* Descriptors registered with epfd */
+};
+
+static Watchset watchsets;
+#endif
+
 /* Helper functions */
 
+static void
+selset_add(struct selset *set, int fd, int what)
+{
+    if (set->nfds == set->size) {
+	int newsize = set->size ? 2 * set->size : 16;
+	set->fds = (struct selfd *)zrealloc(set->fds,
+					    newsize * sizeof(struct selfd));
+	set->size = newsize;
+    }
+    set->fds[set->nfds].fd = fd;
+    set->fds[set->nfds].what = what;
+    set->nfds++;
+}
+
+static void
+selset_free(struct selset *set)
+{
+    if (set->fds)
+	zfree(set->fds, set->size * sizeof(struct selfd));
+    set->fds = NULL;
+    set->nfds = set->size = 0;
+}
+
+static int
+selfdcmp(const void *a, const void *b)
+{
+    return ((const struct selfd *)a)->fd - ((const struct selfd *)b)->fd;
+}
+
+/*
+ * Sort the set by file descriptor and merge duplicate entries,
+ * so each descriptor appears once with all its conditions.
+ */
+
+static void
+selset_normalise(struct selset *set)
+{
+    int i, j;
+
+    if (set->nfds < 2)
+	return;
+    qsort(set->fds, set->nfds, sizeof(struct selfd), selfdcmp);
+    for (i = 0, j = 1; j < set->nfds; j++) {
+	if (set->fds[j].fd == set->fds[i].fd)
+	    set->fds[i].what |= set->fds[j].what;
+	else
+	    set->fds[++i] = set->fds[j];
+    }
+    set->nfds = i + 1;
+}
+
 /*
- * Handle an fd by adding it to the current fd_set.
+ * Handle an fd by adding it to the set with the conditions what.
  * Return 1 for error (after printing a message), 0 for OK.
  */
 static int
-handle_digits(char *nam, char *argptr, fd_set *fdset, int *fdmax)
+handle_digits(char *nam, char *argptr, struct selset *set, int what)
 {
     int fd;
     char *endptr;
@@ -52,29 +164,425 @@ handle_digits(char *nam, char *argptr, fd_set *fdset, int *fdmax)
 	return 1;
     }
 
-    FD_SET(fd, fdset);
-    if (fd+1 > *fdmax)
-	*fdmax = fd+1;
+    selset_add(set, fd, what);
     return 0;
 }
 
-/* The builtin itself */
+/*
+ * Turn a normalised set into an array in the form used for the
+ * result: either `-r 0 -w 1' or, if hash is set, key/value pairs
+ * of a file descriptor and a subset of "rwe".
+ */
+
+static char **
+selset_toarray(struct selset *set, int hash)
+{
+    char **outdata, **outptr, buf[BDIGBUFSIZE];
+    int i, n;
+
+    outptr = outdata = (char **)zalloc((2*set->nfds+4)*sizeof(char *));
+    if (hash) {
+	for (n = 0; n < set->nfds; n++) {
+	    char *ptr = buf;
+	    convbase(buf, set->fds[n].fd, 10);
+	    *outptr++ = ztrdup(buf);
+	    for (i = 0; i < 3; i++)
+		if (set->fds[n].what & (1 << i))
+		    *ptr++ = fdchar[i];
+	    *ptr = '\0';
+	    *outptr++ = ztrdup(buf);
+	}
+    } else {
+	for (i = 0; i < 3; i++) {
+	    int doneit = 0;
+	    for (n = 0; n < set->nfds; n++) {
+		if (!(set->fds[n].what & (1 << i)))
+		    continue;
+		if (!doneit) {
+		    buf[0] = '-';
+		    buf[1] = fdchar[i];
+		    buf[2] = '\0';
+		    *outptr++ = ztrdup(buf);
+		    doneit = 1;
+		}
+		convbase(buf, set->fds[n].fd, 10);
+		*outptr++ = ztrdup(buf);
+	    }
+	}
+    }
+    *outptr = NULL;
+    return outdata;
+}
+
+/*
+ * Read the watch set stored in the array parameter name, which is
+ * in the same form as the arguments, into set.  An unset parameter
+ * gives an empty set.
+ */
 
-/**/
 static int
-bin_zselect(char *nam, char **args, UNUSED(Options ops), UNUSED(int func))
+getwatchset(char *nam, char *name, struct selset *set)
+{
+    char **arr, *argptr;
+    int what = ZSEL_READ;
+
+    if (!(arr = getaparam(name))) {
+	if (getsparam(name)) {
+	    zwarnnam(nam, "watch set is not an array: %s", name);
+	    return 1;
+	}
+	return 0;
+    }
+    for (; *arr; arr++) {
+	argptr = *arr;
+	if (*argptr == '-') {
+	    for (argptr++; *argptr; argptr++) {
+		switch (*argptr) {
+		case 'r':
+		    what = ZSEL_READ;
+		    break;
+
+		case 'w':
+		    what = ZSEL_WRITE;
+		    break;
+
+		case 'e':
+		    what = ZSEL_EXCEPT;
+		    break;
+
+		default:
+		    if (handle_digits(nam, argptr, set, what))
+			return 1;
+		    while (argptr[1])
+			argptr++;
+		    break;
+		}
+	    }
+	} else if (handle_digits(nam, argptr, set, what))
+	    return 1;
+    }
+    return 0;
+}
+
+/*
+ * Return the time left in milliseconds before the deadline, or -1
+ * to block indefinitely if there is no deadline.
+ */
+
+static int
+timeleft(struct timeval *deadline)
+{
+    struct timeval now;
+    long left;
+
+    if (!deadline)
+	return -1;
+    gettimeofday(&now, NULL);
+    left = (deadline->tv_sec - now.tv_sec) * 1000L +
+	(deadline->tv_usec - now.tv_usec) / 1000L;
+    return left < 0 ? 0 : (int)left;
+}
+
+#ifdef USE_EPOLL
+
+static int
+epollevents(int what)
+{
+    int events = 0;
+
+    if (what & ZSEL_READ)
+	events |= EPOLLIN;
+    if (what & ZSEL_WRITE)
+	events |= EPOLLOUT;
+    if (what & ZSEL_EXCEPT)
+	events |= EPOLLPRI;
+    return events;
+}
+
+static void
+freewatchset(Watchset ws)
+{
+    zclose(ws->epfd);
+    zsfree(ws->name);
+    selset_free(&ws->reg);
+    zfree(ws, sizeof(*ws));
+}
+
+/*
+ * Find the epoll instance for the watch set called name, creating
+ * it if necessary.  An instance inherited by a subshell is not used,
+ * since changes to it would be seen by the parent.
+ */
+
+static Watchset
+getepollset(char *nam, char *name)
 {
-#ifdef HAVE_SELECT
-    int i, fd, fdsetind = 0, fdmax = 0, fdcount;
+    Watchset ws, *wsp;
+
+    for (wsp = &watchsets; (ws = *wsp); wsp = &ws->next) {
+	if (!strcmp(ws->name, name)) {
+	    if (ws->pid == getpid())
+		return ws;
+	    *wsp = ws->next;
+	    freewatchset(ws);
+	    break;
+	}
+    }
+
+    ws = (Watchset)zshcalloc(sizeof(*ws));
+    if ((ws->epfd = movefd(epoll_create1(EPOLL_CLOEXEC))) < 0) {
+	zwarnnam(nam, "can't create epoll instance: %e", errno);
+	zfree(ws, sizeof(*ws));
+	return NULL;
+    }
+    ws->name = ztrdup(name);
+    ws->pid = getpid();
+    ws->next = watchsets;
+    watchsets = ws;
+    return ws;
+}
+
+/*
+ * Bring the kernel's idea of the watch set into line with set,
+ * which is normalised.  Both lists are sorted, so a single merge
+ * pass finds the descriptors to add, change and remove.
+ *
+ * epoll refuses regular files and the like, for which poll and
+ * select always report the descriptor as ready; those are marked
+ * ZSEL_NOEPOLL in the registered set and reported directly.
+ */
+
+static int
+syncepollset(char *nam, Watchset ws, struct selset *set)
+{
+    struct selfd *old = ws->reg.fds, *new = set->fds;
+    int nold = ws->reg.nfds, nnew = set->nfds, i = 0, j = 0, flags;
+    struct selset reg;
+    struct epoll_event ev;
+    Watchset *wsp;
+
+    memset(&reg, 0, sizeof(reg));
+    while (i < nold || j < nnew) {
+	if (j == nnew || (i < nold && old[i].fd < new[j].fd)) {
+	    /* The descriptor may already have gone, so ignore errors. */
+	    if (!(old[i].what & ZSEL_NOEPOLL))
+		epoll_ctl(ws->epfd, EPOLL_CTL_DEL, old[i].fd, &ev);
+	    i++;
+	    continue;
+	}
+	memset(&ev, 0, sizeof(ev));
+	ev.events = epollevents(new[j].what);
+	ev.data.fd = new[j].fd;
+	flags = 0;
+	if (i == nold || old[i].fd > new[j].fd ||
+	    (old[i].what & ZSEL_NOEPOLL)) {
+	    if (i < nold && old[i].fd == new[j].fd)
+		i++;
+	    if (epoll_ctl(ws->epfd, EPOLL_CTL_ADD, new[j].fd, &ev) < 0 &&
+		(errno != EEXIST ||
+		 epoll_ctl(ws->epfd, EPOLL_CTL_MOD, new[j].fd, &ev) < 0)) {
+		if (errno != EPERM)
+		    break;
+		flags = ZSEL_NOEPOLL;
+	    }
+	} else {
+	    if (old[i].what != new[j].what &&
+		epoll_ctl(ws->epfd, EPOLL_CTL_MOD, new[j].fd, &ev) < 0 &&
+		(errno != ENOENT ||
+		 epoll_ctl(ws->epfd, EPOLL_CTL_ADD, new[j].fd, &ev) < 0))
+		break;
+	    i++;
+	}
+	selset_add(&reg, new[j].fd, new[j].what | flags);
+	j++;
+    }
+    if (i < nold || j < nnew) {
+	zwarnnam(nam, "error on select: %e (file descriptor %d)",
+		 errno, new[j].fd);
+	selset_free(&reg);
+	/* Start again from scratch next time. */
+	for (wsp = &watchsets; *wsp; wsp = &(*wsp)->next) {
+	    if (*wsp == ws) {
+		*wsp = ws->next;
+		break;
+	    }
+	}
+	freewatchset(ws);
+	return 1;
+    }
+
+    selset_free(&ws->reg);
+    ws->reg = reg;
+    return 0;
+}
+
+/*
+ * Wait for the watch set.  Return the number of ready descriptors,
+ * which are added to ready, or -1 for error.
+ */
+
+static int
+waitepoll(char *nam, char *name, struct selset *set,
+	  struct timeval *deadline, struct selset *ready)
+{
+    Watchset ws;
+    struct epoll_event *evs;
+    int i, nev, nready = 0, maxev = set->nfds ? set->nfds : 1;
+
+    if (!(ws = getepollset(nam, name)) || syncepollset(nam, ws, set))
+	return -1;
+
+    for (i = 0; i < ws->reg.nfds; i++) {
+	if (ws->reg.fds[i].what & ZSEL_NOEPOLL) {
+	    selset_add(ready, ws->reg.fds[i].fd,
+		       ws->reg.fds[i].what & ~ZSEL_NOEPOLL);
+	    nready++;
+	}
+    }
+
+    evs = (struct epoll_event *)zalloc(maxev * sizeof(*evs));
+    do {
+	nev = epoll_wait(ws->epfd, evs, maxev,
+			 nready ? 0 : timeleft(deadline));
+    } while (nev < 0 && errno == EINTR && !errflag);
+
+    if (nev < 0)
+	zwarnnam(nam, "error on select: %e", errno);
+    for (i = 0; i < nev; i++) {
+	int what = 0, events = evs[i].events;
+	struct selfd key, *sfd;
+
+	key.fd = evs[i].data.fd;
+	if (!(sfd = (struct selfd *)bsearch(&key, set->fds, set->nfds,
+					    sizeof(struct selfd), selfdcmp)))
+	    continue;
+
+	if (events & (EPOLLIN|EPOLLHUP|EPOLLERR))
+	    what |= ZSEL_READ;
+	if (events & (EPOLLOUT|EPOLLERR))
+	    what |= ZSEL_WRITE;
+	if (events & (EPOLLPRI|EPOLLHUP|EPOLLERR))
+	    what |= ZSEL_EXCEPT;
+	if ((what &= sfd->what))
+	    selset_add(ready, key.fd, what);
+    }
+    zfree(evs, maxev * sizeof(*evs));
+    return nev < 0 ? nev : nev + nready;
+}
+
+#endif /* USE_EPOLL */
+
+#if defined(HAVE_POLL) || defined(HAVE_SELECT)
+
+/*
+ * Wait for the descriptors in the normalised set.  Return the number
+ * of ready descriptors, which are added to ready, or -1 for error.
+ */
+
+static int
+waitfds(char *nam, struct selset *set, struct timeval *deadline,
+	struct selset *ready)
+{
+    int i, n;
+# ifdef HAVE_POLL
+    struct pollfd *fds;
+
+    fds = (struct pollfd *)zalloc((set->nfds + 1) * sizeof(*fds));
+    for (i = 0; i < set->nfds; i++) {
+	fds[i].fd = set->fds[i].fd;
+	fds[i].events = (((set->fds[i].what & ZSEL_READ) ? POLLIN : 0) |
+			 ((set->fds[i].what & ZSEL_WRITE) ? POLLOUT : 0) |
+			 ((set->fds[i].what & ZSEL_EXCEPT) ? POLLPRI : 0));
+	fds[i].revents = 0;
+    }
+
+    errno = 0;
+    do {
+	n = poll(fds, set->nfds, timeleft(deadline));
+    } while (n < 0 && errno == EINTR && !errflag);
+
+    for (i = 0; n > 0 && i < set->nfds; i++) {
+	int what = 0, revents = fds[i].revents;
+
+	if (revents & POLLNVAL) {
+	    errno = EBADF;
+	    n = -1;
+	    break;
+	}
+	if (revents & (POLLIN|POLLHUP|POLLERR))
+	    what |= ZSEL_READ;
+	if (revents & (POLLOUT|POLLERR))
+	    what |= ZSEL_WRITE;
+	if (revents & (POLLPRI|POLLHUP|POLLERR))
+	    what |= ZSEL_EXCEPT;
+	if ((what &= set->fds[i].what))
+	    selset_add(ready, set->fds[i].fd, what);
+    }
+    zfree(fds, (set->nfds + 1) * sizeof(*fds));
+# else
     fd_set fdset[3];
-    const char fdchar[3] = "rwe";
-    struct timeval tv, *tvptr = NULL;
-    char *outarray = "reply", **outdata, **outptr;
-    char *outhash = NULL;
-    LinkList fdlist;
+    int fdmax = 0, left;
+    struct timeval tv;
 
     for (i = 0; i < 3; i++)
 	FD_ZERO(fdset+i);
+    for (n = 0; n < set->nfds; n++) {
+	if (set->fds[n].fd >= FD_SETSIZE) {
+	    zwarnnam(nam, "file descriptor too large for select: %d",
+		     set->fds[n].fd);
+	    return -1;
+	}
+	for (i = 0; i < 3; i++)
+	    if (set->fds[n].what & (1 << i))
+		FD_SET(set->fds[n].fd, fdset+i);
+	fdmax = set->fds[n].fd + 1;
+    }
+
+    errno = 0;
+    do {
+	if ((left = timeleft(deadline)) >= 0) {
+	    tv.tv_sec = left / 1000;
+	    tv.tv_usec = (left % 1000) * 1000L;
+	}
+	n = select(fdmax, (SELECT_ARG_2_T)fdset, (SELECT_ARG_2_T)(fdset+1),
+		   (SELECT_ARG_2_T)(fdset+2), left < 0 ? NULL : &tv);
+    } while (n < 0 && errno == EINTR && !errflag);
+
+    for (i = 0; n > 0 && i < set->nfds; i++) {
+	int what = 0, fd = set->fds[i].fd;
+
+	if (FD_ISSET(fd, fdset))
+	    what |= ZSEL_READ;
+	if (FD_ISSET(fd, fdset+1))
+	    what |= ZSEL_WRITE;
+	if (FD_ISSET(fd, fdset+2))
+	    what |= ZSEL_EXCEPT;
+	if (what)
+	    selset_add(ready, fd, what);
+    }
+# endif
+
+    if (n < 0)
+	zwarnnam(nam, "error on select: %e", errno);
+    return n;
+}
+
+#endif /* defined(HAVE_POLL) || defined(HAVE_SELECT) */
+
+/* The builtin itself */
+
+/**/
+static int
+bin_zselect(char *nam, char **args, UNUSED(Options ops), UNUSED(int func))
+{
+#if defined(HAVE_POLL) || defined(HAVE_SELECT)
+    int i, what = ZSEL_READ, ret = 1;
+    struct timeval deadline, *dlptr = NULL;
+    char *outarray = "reply", *outhash = NULL, *watchname = NULL;
+    struct selset set, ready;
+
+    memset(&set, 0, sizeof(set));
+    memset(&ready, 0, sizeof(ready));
 
     for (; *args; args++) {
 	char *argptr = *args, *endptr;
@@ -86,9 +594,11 @@ bin_zselect(char *nam, char **args, UNUSED(Options ops), UNUSED(int func))
 		     * Array name for reply, if not $reply.
 		     * This gets set to e.g. `-r 0 -w 1' if 0 is ready
 		     * for reading and 1 is ready for writing.
+		     * Also the name of the array holding a watch set.
 		     */
 		case 'a':
 		case 'A':
+		case 'W':
 		    i = *argptr;
 		    if (argptr[1])
 			argptr++;
@@ -96,16 +606,18 @@ bin_zselect(char *nam, char **args, UNUSED(Options ops), UNUSED(int func))
 			argptr = *++args;
 		    } else {
 			zwarnnam(nam, "argument expected after -%c", *argptr);
-			return 1;
+			goto done;
 		    }
 		    if (idigit(*argptr) || !isident(argptr)) {
 			zwarnnam(nam, "invalid array name: %s", argptr);
-			return 1;
+			goto done;
 		    }
 		    if (i == 'a')
 			outarray = argptr;
-		    else
+		    else if (i == 'A')
 			outhash = argptr;
+		    else
+			watchname = argptr;
 		    /* set argptr to next to last char because of increment */
 		    while (argptr[1])
 			argptr++;
@@ -113,17 +625,17 @@ bin_zselect(char *nam, char **args, UNUSED(Options ops), UNUSED(int func))
 
 		    /* Following numbers indicate fd's for reading */
 		case 'r':
-		    fdsetind = 0;
+		    what = ZSEL_READ;
 		    break;
 
 		    /* Following numbers indicate fd's for writing */
 		case 'w':
-		    fdsetind = 1;
+		    what = ZSEL_WRITE;
 		    break;
 
 		    /* Following numbers indicate fd's for errors */
 		case 'e':
-		    fdsetind = 2;
+		    what = ZSEL_EXCEPT;
 		    break;
 
 		    /*
@@ -138,22 +650,27 @@ bin_zselect(char *nam, char **args, UNUSED(Options ops), UNUSED(int func))
 			argptr = *++args;
 		    } else {
 			zwarnnam(nam, "argument expected after -%c", *argptr);
-			return 1;
+			goto done;
 		    }
 		    if (!idigit(*argptr)) {
 			zwarnnam(nam, "number expected after -t");
-			return 1;
+			goto done;
 		    }
 		    tempnum = zstrtol(argptr, &endptr, 10);
 		    if (*endptr) {
 			zwarnnam(nam, "garbage after -t argument: %s",
 				 endptr);
-			return 1;
+			goto done;
 		    }
 		    /* timevalue now active */
-		    tvptr = &tv;
-		    tv.tv_sec = (long)(tempnum / 100);
-		    tv.tv_usec = (long)(tempnum % 100) * 10000L;
+		    dlptr = &deadline;
+		    gettimeofday(&deadline, NULL);
+		    deadline.tv_sec += (long)(tempnum / 100);
+		    deadline.tv_usec += (long)(tempnum % 100) * 10000L;
+		    if (deadline.tv_usec >= 1000000L) {
+			deadline.tv_sec++;
+			deadline.tv_usec -= 1000000L;
+		    }
 
 		    /* remember argptr is incremented at end of loop */
 		    argptr = endptr - 1;
@@ -161,107 +678,56 @@ bin_zselect(char *nam, char **args, UNUSED(Options ops), UNUSED(int func))
 
 		    /* Digits following option without arguments are fd's. */
 		default:
-		    if (handle_digits(nam, argptr, fdset+fdsetind,
-				      &fdmax))
-			return 1;
-		}
-	    }
-	} else if (handle_digits(nam, argptr, fdset+fdsetind, &fdmax))
-	    return 1;
-    }
-
-    errno = 0;
-    do {
-	i = select(fdmax, (SELECT_ARG_2_T)fdset, (SELECT_ARG_2_T)(fdset+1),
-		   (SELECT_ARG_2_T)(fdset+2), tvptr);
-    } while (i < 0 && errno == EINTR && !errflag);
-
-    if (i <= 0) {
-	if (i < 0)
-	    zwarnnam(nam, "error on select: %e", errno);
-	/* else no fd's set.  Presumably a timeout. */
-	return 1;
-    }
-
-    /*
-     * Make a linked list of all file descriptors which are ready.
-     * These go into an array preceded by -r, -w or -e for read, write,
-     * error as appropriate.  Typically there will only be one set
-     * so this looks rather like overkill.
-     */
-    fdlist = znewlinklist();
-    for (i = 0; i < 3; i++) {
-	int doneit = 0;
-	for (fd = 0; fd < fdmax; fd++) {
-	    if (FD_ISSET(fd, fdset+i)) {
-		char buf[BDIGBUFSIZE];
-		if (outhash) {
-		    /*
-		     * Key/value pairs; keys are fd's (as strings),
-		     * value is a (possibly improper) subset of "rwe".
-		     */
-		    LinkNode nptr;
-		    int found = 0;
-
-		    convbase(buf, fd, 10);
-		    for (nptr = firstnode(fdlist); nptr; 
-			 nptr = nextnode(nextnode(nptr))) {
-			if (!strcmp((char *)getdata(nptr), buf)) {
-			    /* Already there, add new character. */
-			    void **dataptr = getaddrdata(nextnode(nptr));
-			    char *data = (char *)*dataptr, *ptr;
-			    found = 1;
-			    if (!strchr(data, fdchar[i])) {
-				strcpy(buf, data);
-				for (ptr = buf; *ptr; ptr++)
-				    ;
-				*ptr++ = fdchar[i];
-				*ptr = '\0';
-				zsfree(data);
-				*dataptr = ztrdup(buf);
-			    }
-			    break;
-			}
-		    }
-		    if (!found) {
-			/* Add new key/value pair. */
-			zaddlinknode(fdlist, ztrdup(buf));
-			buf[0] = fdchar[i];
-			buf[1] = '\0';
-			zaddlinknode(fdlist, ztrdup(buf));
-		    }
-		} else {
-		    /* List of fd's preceded by -r, -w, -e. */
-		    if (!doneit) {
-			buf[0] = '-';
-			buf[1] = fdchar[i];
-			buf[2] = 0;
-			zaddlinknode(fdlist, ztrdup(buf));
-			doneit = 1;
-		    }
-		    convbase(buf, fd, 10);
-		    zaddlinknode(fdlist, ztrdup(buf));
+		    if (handle_digits(nam, argptr, &set, what))
+			goto done;
+		    /* set argptr to next to last char because of increment */
+		    while (argptr[1])
+			argptr++;
+		    break;
 		}
 	    }
-	}
+	} else if (handle_digits(nam, argptr, &set, what))
+	    goto done;
     }
 
-    /* convert list to array */
-    fdcount = countlinknodes(fdlist);
-    outptr = outdata = (char **)zalloc((fdcount+1)*sizeof(char *));
-    while (nonempty(fdlist))
-	*outptr++ = getlinknode(fdlist);
-    *outptr = '\0';
-    /* and store in array parameter */
-    if (outhash)
-	sethparam(outhash, outdata);
+    if (watchname) {
+	/*
+	 * Descriptors given on the command line are added to the
+	 * watch set, which is then stored back in normal form.
+	 * The whole set is waited for.
+	 */
+	int nargs = set.nfds;
+
+	if (getwatchset(nam, watchname, &set))
+	    goto done;
+	selset_normalise(&set);
+	if (nargs)
+	    setaparam(watchname, selset_toarray(&set, 0));
+    } else
+	selset_normalise(&set);
+
+#ifdef USE_EPOLL
+    if (watchname)
+	i = waitepoll(nam, watchname, &set, dlptr, &ready);
     else
-	setaparam(outarray, outdata);
-    freelinklist(fdlist, NULL);
+#endif
+	i = waitfds(nam, &set, dlptr, &ready);
+
+    /* else no fd's set.  Presumably a timeout. */
+    if (i > 0 && ready.nfds) {
+	selset_normalise(&ready);
+	if (outhash)
+	    sethparam(outhash, selset_toarray(&ready, 1));
+	else
+	    setaparam(outarray, selset_toarray(&ready, 0));
+	ret = 0;
+    }
 
-    return 0;
+ done:
+    selset_free(&set);
+    selset_free(&ready);
+    return ret;
 #else
-    /* TODO: use poll */
     zerrnam(nam, "your system does not implement the select system call.");
     return 2;
 #endif
@@ -324,5 +790,12 @@ cleanup_(Module m)
 int
 finish_(UNUSED(Module m))
 {
+#ifdef USE_EPOLL
+    while (watchsets) {
+	Watchset ws = watchsets;
+	watchsets = ws->next;
+	freewatchset(ws);
+    }
+#endif
     return 0;
 }
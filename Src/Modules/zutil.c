@@ -55,6 +55,27 @@ struct stypat {
 
 static HashTable zstyletab;
 
+/*
+ * Cache of style lookups.  The completion system looks up the same
+ * styles for the same contexts many times, and trying the patterns
+ * in turn is a large part of the cost.  Each entry records, for a
+ * style and a context, the pattern that matched or that none did.
+ * Entries are only valid while zstylegen, which changes whenever a
+ * style is set or deleted, has the value they were made with.
+ */
+
+#define ZSTYCACHESIZE 1024
+
+struct stycache {
+    Style style;
+    char *ctxt;
+    Stypat pat;			/* pattern that matched, NULL for none */
+    unsigned int gen;		/* value of zstylegen when made */
+};
+
+static struct stycache *zstycache;
+static unsigned int zstylegen;
+
 /* Memory stuff. */
 
 static void
@@ -100,6 +121,7 @@ freestylenode(HashNode hn)
 static void
 freestypat(Stypat p, Style s, Stypat prev)
 {
+    zstylegen++;
     if (s) {
 	if (prev)
 	    prev->next = p->next;
@@ -248,6 +270,7 @@ setstypat(Style s, char *pat, Patprog prog, char **vals, int eval)
     Stypat p, q, qq;
     Eprog eprog = NULL;
 
+    zstylegen++;
     if (eval) {
 	int ef = errflag;
 
@@ -370,17 +393,48 @@ lookupstyle(char *ctxt, char *style)
 {
     Style s;
     Stypat p;
+    struct stycache *c;
+    int cache = 1;
 
     s = (Style)zstyletab->getnode2(zstyletab, style);
     if (!s)
 	return NULL;
-    for (p = s->pats; p; p = p->next)
-	if (pattry(p->prog, ctxt))
-	    return (p->eval ? evalstyle(p) : p->vals);
+    c = zstycache + (hasher(ctxt) ^ (unsigned)((size_t)s / sizeof(*s))) %
+	ZSTYCACHESIZE;
+    if (c->gen == zstylegen && c->style == s && !strcmp(c->ctxt, ctxt))
+	p = c->pat;
+    else {
+	for (p = s->pats; p; p = p->next) {
+	    /* Matching sets $match etc. with backreferences. */
+	    if (p->prog->patnpar ||
+		((p->prog->globflags | p->prog->globend) &
+		 (GF_BACKREF|GF_MATCHREF)))
+		cache = 0;
+	    if (pattry(p->prog, ctxt))
+		break;
+	}
+	if (cache) {
+	    zsfree(c->ctxt);
+	    c->ctxt = ztrdup(ctxt);
+	    c->style = s;
+	    c->pat = p;
+	    c->gen = zstylegen;
+	}
+    }
+    if (p)
+	return (p->eval ? evalstyle(p) : p->vals);
 
     return NULL;
 }
 
+/* Add the names of all styles to zstyle_list. */
+
+static void
+scanstylenames(HashNode hn, UNUSED(int flags))
+{
+    addlinknode(zstyle_list, hn->nam);
+}
+
 static int
 bin_zstyle(char *nam, char **args, UNUSED(Options ops), UNUSED(int func))
 {
@@ -483,6 +537,7 @@ bin_zstyle(char *nam, char **args, UNUSED(Options ops), UNUSED(int func))
     case 'T': min = 2; max = -1; break;
     case 'm': min = 3; max =  3; break;
     case 'g': min = 1; max =  3; break;
+    case 'A': min = 2; max = -1; break;
     default:
 	zwarnnam(nam, "invalid option: %s", args[0]);
 	return 1;
@@ -525,8 +580,10 @@ bin_zstyle(char *nam, char **args, UNUSED(Options ops), UNUSED(int func))
 		    scanhashtable(zstyletab, 0, 0, 0, scanpatstyles,
 				  ZSPAT_REMOVE);
 		}
-	    } else
+	    } else {
+		zstylegen++;
 		zstyletab->emptytable(zstyletab);
+	    }
 	}
 	break;
     case 's':
@@ -667,6 +724,36 @@ bin_zstyle(char *nam, char **args, UNUSED(Options ops), UNUSED(int func))
 
 	    return ret;
 	}
+    case 'A':
+	{
+	    char **styles, **vals, **ret, **rp;
+	    int val = 1;
+
+	    if (args[3])
+		styles = args + 3;
+	    else {
+		/*
+		 * All styles.  The names are copied, since evaluating
+		 * one style might delete another.
+		 */
+		zstyle_list = newlinklist();
+		scanhashtable(zstyletab, 1, 0, 0, scanstylenames, 0);
+		styles = hlinklist2array(zstyle_list, 1);
+	    }
+	    rp = ret = (char **)
+		zalloc((2 * arrlen(styles) + 1) * sizeof(char *));
+	    for (; *styles; styles++) {
+		if ((vals = lookupstyle(args[1], *styles))) {
+		    *rp++ = ztrdup(*styles);
+		    *rp++ = sepjoin(vals, " ", 0);
+		    val = 0;
+		}
+	    }
+	    *rp = NULL;
+	    sethparam(args[2], ret);
+
+	    return val;
+	}
     }
     return 0;
 }
@@ -1886,6 +1973,9 @@ int
 setup_(UNUSED(Module m))
 {
     zstyletab = newzstyletable(17, "zstyletab");
+    zstycache = (struct stycache *)
+	zshcalloc(ZSTYCACHESIZE * sizeof(struct stycache));
+    zstylegen = 1;
 
     return 0;
 }
@@ -1923,7 +2013,12 @@ cleanup_(Module m)
 int
 finish_(UNUSED(Module m))
 {
+    int i;
+
     deletehashtable(zstyletab);
+    for (i = 0; i < ZSTYCACHESIZE; i++)
+	zsfree(zstycache[i].ctxt);
+    zfree(zstycache, ZSTYCACHESIZE * sizeof(struct stycache));
 
     return 0;
 }
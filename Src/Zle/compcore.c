@@ -366,6 +366,7 @@ do_completion(UNUSED(Hookdef dummy), Compldat dat)
     zsfree(lastprebr);
     zsfree(lastpostbr);
     lastprebr = lastpostbr = NULL;
+    comptimematches = nmatches;
 
     if (comppatmatch && *comppatmatch && comppatmatch != opm)
 	haspattern = 1;
@@ -943,6 +944,7 @@ makecomplist(char *s, int incmd, int lst)
 {
     char *p;
     int owb = wb, owe = we, ooffs = offs;
+    double start;
 
     /* Inside $... ? */
     if (compfunc && (p = check_param(s, 0, 0))) {
@@ -984,7 +986,9 @@ makecomplist(char *s, int incmd, int lst)
 	menucmp = menuacc = newmatches = onlyexpl = 0;
 
 	s = dupstring(os);
+	start = zmonotime();
 	callcompfunc(s, compfunc);
+	comptimes[CT_FUNCTION] += zmonotime() - start;
 	endcmgroup(NULL);
 
 	/* Needed for compcall. */
@@ -1040,7 +1044,9 @@ makecomplist(char *s, int incmd, int lst)
 	dat.str = s;
 	dat.incmd = incmd;
 	dat.lst = lst;
+	start = zmonotime();
 	runhookdef(COMPCTLMAKEHOOK, (void *) &dat);
+	comptimes[CT_FUNCTION] += zmonotime() - start;
 
 	/* Needed for compcall. */
 	runhookdef(COMPCTLCLEANUPHOOK, NULL);
@@ -2022,7 +2028,7 @@ addmatches(Cadata dat, char **argv)
     char *oqp = qipre, *oqs = qisuf, qc, **disp = NULL, *ibuf = NULL;
     char **arrays = NULL;
     int lpl, lsl, pl, sl, bcp = 0, bcs = 0, bpadd = 0, bsadd = 0;
-    int ppl = 0, psl = 0, ilen = 0;
+    int ppl = 0, psl = 0, ilen = 0, litpl = 0;
     int llpl = 0, llsl = 0, nm = mnum, gflags = 0, ohp = haspattern;
     int isexact, doadd, ois = instring, oib = inbackt;
     Cline lc = NULL, pline = NULL, sline = NULL;
@@ -2373,6 +2379,21 @@ addmatches(Cadata dat, char **argv)
 	    if (lsuf)
 		lsuf = multiquote(lsuf, 1);
 	}
+	/* Without match specs or a pattern, comp_match() only accepts a
+	 * word if its quoted form starts with the prefix, skipping
+	 * backslashes in the word.  Backslash quoting only inserts strings
+	 * starting with a backslash, a quote or a `$', so the word itself
+	 * must start with the characters of the prefix before the first of
+	 * those.  Testing that first saves quoting and matching the words
+	 * that can't match, usually most of them. */
+	if ((dat->aflags & CAF_MATCH) && lpre && !cp && !mstack) {
+	    char *q = compqstack;
+
+	    while (q && *q == QT_BACKSLASH)
+		q++;
+	    if (!q || !*q)
+		litpl = strcspn(lpre, "\\'\"$");
+	}
 	/* Walk through the matches given. */
 	obpl = bpl;
 	obsl = bsl;
@@ -2441,6 +2462,11 @@ addmatches(Cadata dat, char **argv)
 		    goto next_array;
 		}
 	    }
+	    if (litpl && strncmp(s, lpre, litpl)) {
+		if (dparr && !*++dparr)
+		    dparr = NULL;
+		goto next_array;
+	    }
 	    if (!(dat->aflags & CAF_MATCH)) {
 		if (dat->aflags & CAF_QUOTE)
 		    ms = dupstring(s);
@@ -3116,6 +3142,26 @@ matcheq(Cmatch a, Cmatch b)
 	  matchstreq(a->str, b->str)));
 }
 
+/* A hash value for the strings compared by matcheq(). */
+
+#define matchstrhash(h, s) ((h) * 31 + ((s) ? hasher(s) + 1 : 0))
+
+/**/
+static unsigned
+matchhash(Cmatch m)
+{
+    unsigned h = 0;
+
+    h = matchstrhash(h, m->ipre);
+    h = matchstrhash(h, m->pre);
+    h = matchstrhash(h, m->ppre);
+    h = matchstrhash(h, m->psuf);
+    h = matchstrhash(h, m->suf);
+    h = matchstrhash(h, m->disp);
+
+    return matchstrhash(h, m->str);
+}
+
 /* Make an array from a linked list. The second argument says whether *
  * the array should be sorted. The third argument is used to return   *
  * the number of elements in the resulting array. The fourth argument *
@@ -3128,6 +3174,7 @@ makearray(LinkList l, int type, int flags, int *np, int *nlp, int *llp)
     Cmatch *ap, *bp, *cp, *rp;
     LinkNode nod;
     int n, nl = 0, ll = 0;
+    double start = zmonotime();
 
     /* Build an array for the matches. */
     rp = ap = (Cmatch *) hcalloc(((n = countlinknodes(l)) + 1) *
@@ -3188,27 +3235,42 @@ makearray(LinkList l, int type, int flags, int *np, int *nlp, int *llp)
 	    }
 	} else {
 	    if (!(flags & CGF_UNIQALL) && !(flags & CGF_UNIQCON)) {
-                int dup;
+		/* The matches aren't sorted, so equal ones are found in a
+		 * hash table (with linear probing) instead of comparing
+		 * every pair, which takes far too long for many matches. */
+		Cmatch *htab;
+		unsigned tsize, h;
+
+		for (tsize = 64; tsize < 2 * (unsigned) n; tsize <<= 1);
+		htab = (Cmatch *) hcalloc(tsize * sizeof(Cmatch));
+
+		/* Delete the ones that occur more than once... */
+		for (ap = cp = rp; *ap; ap++) {
+		    for (h = matchhash(*ap) & (tsize - 1);
+			 htab[h] && !matcheq(htab[h], *ap);
+			 h = (h + 1) & (tsize - 1));
+		    if (htab[h])
+			n--;
+		    else
+			*cp++ = htab[h] = *ap;
+		}
+		*cp = NULL;
 
+		/* ...and mark those that would show the same string in
+		 * the list, the first of them differently. */
+		memset(htab, 0, tsize * sizeof(Cmatch));
 		for (ap = rp; *ap; ap++) {
-		    for (bp = cp = ap + 1; *bp; bp++) {
-			if (!matcheq(*ap, *bp))
-			    *cp++ = *bp;
-			else
-			    n--;
+		    if ((*ap)->disp)
+			continue;
+		    for (h = hasher((*ap)->str) & (tsize - 1);
+			 htab[h] && strcmp(htab[h]->str, (*ap)->str);
+			 h = (h + 1) & (tsize - 1));
+		    if (!htab[h])
+			htab[h] = *ap;
+		    else if (!((*ap)->flags & CMF_MULT)) {
+			(*ap)->flags |= CMF_MULT;
+			htab[h]->flags |= CMF_FMULT;
 		    }
-		    *cp = NULL;
-                    if (!(*ap)->disp) {
-                        for (dup = 0, bp = ap + 1; *bp; bp++)
-                            if (!(*bp)->disp &&
-                                !((*bp)->flags & CMF_MULT) &&
-                                !strcmp((*ap)->str, (*bp)->str)) {
-                                (*bp)->flags |= CMF_MULT;
-                                dup = 1;
-                            }
-                        if (dup)
-                            (*ap)->flags |= CMF_FMULT;
-                    }
 		}
 	    } else if (!(flags & CGF_UNIQCON)) {
 		int dup;
@@ -3241,6 +3303,7 @@ makearray(LinkList l, int type, int flags, int *np, int *nlp, int *llp)
 	*nlp = nl;
     if (llp)
 	*llp = ll;
+    comptimes[CT_SORT] += zmonotime() - start;
     return rp;
 }
 
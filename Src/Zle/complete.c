@@ -526,6 +526,7 @@ bin_compadd(char *name, char **argv, UNUSED(Options ops), UNUSED(int func))
     char *p, **sp, *e, *m = NULL, *mstr = NULL;
     int dm;
     Cmatcher match = NULL;
+    double start;
 
     if (incompfunc != 1) {
 	zwarnnam(name, "can only be called from completion function");
@@ -739,7 +740,9 @@ bin_compadd(char *name, char **argv, UNUSED(Options ops), UNUSED(int func))
 	return 1;
 
     dat.match = match = cpcmatcher(match);
+    start = zmonotime();
     dm = addmatches(&dat, argv);
+    comptimes[CT_COMPADD] += zmonotime() - start;
     freecmatcher(match);
 
     return dm;
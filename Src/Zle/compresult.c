@@ -2314,6 +2314,7 @@ list_matches(UNUSED(Hookdef dummy), UNUSED(void *dummy2))
 {
     struct chdata dat;
     int ret;
+    double start;
 
 #ifdef DEBUG
     /* Sanity check */
@@ -2331,7 +2332,9 @@ list_matches(UNUSED(Hookdef dummy), UNUSED(void *dummy2))
 #endif
     dat.num = nmatches;
     dat.cur = NULL;
+    start = zmonotime();
     ret = runhookdef(COMPLISTMATCHESHOOK, (void *) &dat);
+    comptimes[CT_LIST] += zmonotime() - start;
 
     return ret;
 }
@@ -876,7 +876,8 @@ struct cadef {
     Caarg rest;			/* the rest-argument */
     char **defs;		/* the original strings */
     int ndefs;			/* number of ... */
-    int lastt;			/* last time this was used */
+    unsigned int hash;		/* hash of defs, see arrhash() */
+    int lastt;			/* when this was last used, see get_cadef() */
     Caopt *single;		/* array of single-letter options */
     char *match;		/* -M spec to use */
     int argsactive;		/* if arguments are still allowed */
@@ -933,10 +934,34 @@ struct caarg {
 #define CAA_RARGS  4
 #define CAA_RREST  5
 
-/* The cache of parsed descriptons. */
+/*
+ * The cache of parsed descriptons.  This is a hash table keyed by the
+ * hash of the definitions, chained through the next pointers, which
+ * holds at most MAX_CACACHE definitions; when it is full, the one used
+ * least recently is removed.  Completing for a few dozen commands in
+ * turn shouldn't make the big ones be parsed again.
+ */
+
+#define MAX_CACACHE 64
+#define CACACHE_HSIZE 67
+static Cadef cadef_cache[CACACHE_HSIZE];
+static int ncadefs;
+/* Incremented for each use of a cached definition, for lastt. */
+static int cadef_uses;
+
+/* Hash an array of strings, for the caches of parsed definitions. */
 
-#define MAX_CACACHE 8
-static Cadef cadef_cache[MAX_CACACHE];
+static unsigned int
+arrhash(char **a)
+{
+    unsigned int h = 0;
+
+    if (a)
+	for (; *a; a++)
+	    h = h * 31 + hasher(*a);
+
+    return h;
+}
 
 /* Compare two arrays of strings for equality. */
 
@@ -1112,7 +1137,8 @@ alloc_cadef(char **args, int single, char *match, char *nonarg, int flags)
 	ret->defs = NULL;
 	ret->ndefs = 0;
     }
-    ret->lastt = time(0);
+    ret->hash = 0;
+    ret->lastt = 0;
     ret->set = ret->sname = NULL;
     if (single) {
 	ret->single = (Caopt *) zalloc(256 * sizeof(Caopt));
@@ -1607,22 +1633,35 @@ parse_cadef(char *nam, char **args)
 static Cadef
 get_cadef(char *nam, char **args)
 {
-    Cadef *p, *min, new;
+    Cadef *p, *min, new, old;
     int i, na = arrlen(args);
+    unsigned int h = arrhash(args);
 
-    for (i = MAX_CACACHE, p = cadef_cache, min = NULL; i && *p; p++, i--)
-	if (*p && na == (*p)->ndefs && arrcmp(args, (*p)->defs)) {
-	    (*p)->lastt = time(0);
+    for (p = cadef_cache + h % CACACHE_HSIZE; *p; p = &(*p)->next)
+	if ((*p)->hash == h && na == (*p)->ndefs &&
+	    arrcmp(args, (*p)->defs)) {
+	    (*p)->lastt = ++cadef_uses;
 
 	    return *p;
-	} else if (!min || !*p || (*p)->lastt < (*min)->lastt)
-	    min = p;
-    if (i > 0)
-	min = p;
-    if ((new = parse_cadef(nam, args))) {
-	freecadef(*min);
-	*min = new;
+	}
+    if (!(new = parse_cadef(nam, args)))
+	return NULL;
+    if (ncadefs == MAX_CACACHE) {
+	for (i = 0, min = NULL; i < CACACHE_HSIZE; i++)
+	    for (p = cadef_cache + i; *p; p = &(*p)->next)
+		if (!min || (*p)->lastt < (*min)->lastt)
+		    min = p;
+	old = *min;
+	*min = old->next;
+	freecadef(old);
+	ncadefs--;
     }
+    new->hash = h;
+    new->lastt = ++cadef_uses;
+    new->next = cadef_cache[h % CACACHE_HSIZE];
+    cadef_cache[h % CACACHE_HSIZE] = new;
+    ncadefs++;
+
     return new;
 }
 
@@ -2772,7 +2811,8 @@ struct cvdef {
     Cvval vals;			/* value definitions */
     char **defs;		/* original strings */
     int ndefs;			/* number of ... */
-    int lastt;			/* last time used */
+    unsigned int hash;		/* hash of defs, see arrhash() */
+    int lastt;			/* when last used, see get_cvdef() */
     int words;                  /* if to look at other words */
 };
 
@@ -2792,10 +2832,13 @@ struct cvval {
 #define CVV_ARG   1
 #define CVV_OPT   2
 
-/* Cache. */
+/* Cache, organised like the one for _arguments. */
 
-#define MAX_CVCACHE 8
-static Cvdef cvdef_cache[MAX_CVCACHE];
+#define MAX_CVCACHE 64
+#define CVCACHE_HSIZE 67
+static Cvdef cvdef_cache[CVCACHE_HSIZE];
+static int ncvdefs;
+static int cvdef_uses;
 
 /* Memory stuff. */
 
@@ -2865,7 +2908,8 @@ parse_cvdef(char *nam, char **args)
     ret->vals = NULL;
     ret->defs = zarrdup(oargs);
     ret->ndefs = arrlen(oargs);
-    ret->lastt = time(0);
+    ret->hash = 0;
+    ret->lastt = 0;
     ret->words = words;
 
     for (valp = &(ret->vals); *args; args++) {
@@ -2991,22 +3035,35 @@ parse_cvdef(char *nam, char **args)
 static Cvdef
 get_cvdef(char *nam, char **args)
 {
-    Cvdef *p, *min, new;
+    Cvdef *p, *min, new, old;
     int i, na = arrlen(args);
+    unsigned int h = arrhash(args);
 
-    for (i = MAX_CVCACHE, p = cvdef_cache, min = NULL; *p && i--; p++)
-	if (*p && na == (*p)->ndefs && arrcmp(args, (*p)->defs)) {
-	    (*p)->lastt = time(0);
+    for (p = cvdef_cache + h % CVCACHE_HSIZE; *p; p = &(*p)->next)
+	if ((*p)->hash == h && na == (*p)->ndefs &&
+	    arrcmp(args, (*p)->defs)) {
+	    (*p)->lastt = ++cvdef_uses;
 
 	    return *p;
-	} else if (!min || !*p || (*p)->lastt < (*min)->lastt)
-	    min = p;
-    if (i > 0)
-	min = p;
-    if ((new = parse_cvdef(nam, args))) {
-	freecvdef(*min);
-	*min = new;
+	}
+    if (!(new = parse_cvdef(nam, args)))
+	return NULL;
+    if (ncvdefs == MAX_CVCACHE) {
+	for (i = 0, min = NULL; i < CVCACHE_HSIZE; i++)
+	    for (p = cvdef_cache + i; *p; p = &(*p)->next)
+		if (!min || (*p)->lastt < (*min)->lastt)
+		    min = p;
+	old = *min;
+	*min = old->next;
+	freecvdef(old);
+	ncvdefs--;
     }
+    new->hash = h;
+    new->lastt = ++cvdef_uses;
+    new->next = cvdef_cache[h % CVCACHE_HSIZE];
+    cvdef_cache[h % CVCACHE_HSIZE] = new;
+    ncvdefs++;
+
     return new;
 }
 
@@ -4927,6 +4984,7 @@ setup_(UNUSED(Module m))
 {
     memset(cadef_cache, 0, sizeof(cadef_cache));
     memset(cvdef_cache, 0, sizeof(cvdef_cache));
+    ncadefs = ncvdefs = 0;
 
     memset(comptags, 0, sizeof(comptags));
 
@@ -4969,11 +5027,19 @@ int
 finish_(UNUSED(Module m))
 {
     int i;
+    Cadef d, dn;
+    Cvdef v, vn;
 
-    for (i = 0; i < MAX_CACACHE; i++)
-	freecadef(cadef_cache[i]);
-    for (i = 0; i < MAX_CVCACHE; i++)
-	freecvdef(cvdef_cache[i]);
+    for (i = 0; i < CACACHE_HSIZE; i++)
+	for (d = cadef_cache[i]; d; d = dn) {
+	    dn = d->next;
+	    freecadef(d);
+	}
+    for (i = 0; i < CVCACHE_HSIZE; i++)
+	for (v = cvdef_cache[i]; v; v = vn) {
+	    vn = v->next;
+	    freecvdef(v);
+	}
 
     for (i = 0; i < MAX_TAGS; i++)
 	freectags(comptags[i]);
@@ -358,6 +358,16 @@ struct compldat {
     int incmd;
 };
 
+/* Stages of a completion timed for the comptimes parameter. */
+
+#define CT_FUNCTION 0		/* completion functions or compctl */
+#define CT_COMPADD  1		/* adding matches */
+#define CT_SORT     2		/* sorting matches and removing duplicates */
+#define CT_LIST     3		/* listing matches */
+#define CT_REFRESH  4		/* redisplay after completion */
+#define CT_TOTAL    5		/* the completion as a whole */
+#define CT_NSTAGES  6
+
 /* List completion matches. */
 
 #define listmatches() runhookdef(LISTMATCHESHOOK, NULL)
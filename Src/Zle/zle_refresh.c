@@ -979,6 +979,7 @@ zrefresh(void)
     int txtchange;		/* attributes set after prompts              */
     int rprompt_off;		/* Offset of rprompt from right of screen    */
     struct rparams rpms;
+    double comptime = 0.0;	/* start of redisplay after completion	     */
 #ifdef MULTIBYTE_SUPPORT
     int width;			/* width of wide character		     */
 #endif
@@ -991,6 +992,11 @@ zrefresh(void)
     if (inlist)
 	return;
 
+    if (comptimerefresh) {
+	comptimerefresh = 0;
+	comptime = zmonotime();
+    }
+
     /*
      * zrefresh() is called from all over the place, so we can't
      * be sure if the line is metafied for completion or not.
@@ -1735,6 +1741,9 @@ singlelineout:
 
     if (remetafy)
 	metafy_line();
+
+    if (comptime != 0.0)
+	comptimes[CT_REFRESH] = zmonotime() - comptime;
 }
 
 #define tcinscost(X)   (tccan(TCMULTINS) ? tclen[TCMULTINS] : (X)*tclen[TCINS])
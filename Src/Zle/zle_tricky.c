@@ -174,6 +174,21 @@ mod_export int comprecursive;
 /**/
 int hascompwidgets;
 
+/*
+ * Seconds spent in the stages of the last completion, indexed by the
+ * CT_* values, and the number of matches it found.  These are made
+ * available as $comptimes by the zsh/zleparameter module.  As the
+ * matches are usually listed by the next redisplay, the time of that
+ * is recorded when comptimerefresh is set.
+ */
+
+/**/
+mod_export double comptimes[CT_NSTAGES];
+/**/
+mod_export int comptimematches;
+/**/
+int comptimerefresh;
+
 /*
  * Find out if we have to insert a tab (instead of trying to complete).
  * The line is not metafied here.
@@ -603,6 +618,7 @@ docomplete(int lst)
 
     char *s, *ol;
     int olst = lst, chl = 0, ne = noerrs, ocs, ret = 0, dat[2];
+    double start;
 
     if (active && !comprecursive) {
 	zwarn("completion cannot be used recursively (yet)");
@@ -610,6 +626,10 @@ docomplete(int lst)
     }
     active = 1;
     comprecursive = 0;
+    memset(comptimes, 0, sizeof(comptimes));
+    comptimematches = 0;
+    comptimerefresh = 1;
+    start = zmonotime();
     makecommaspecial(0);
     if (undoing)
 	setlastline();
@@ -623,6 +643,7 @@ docomplete(int lst)
 
     if (runhookdef(BEFORECOMPLETEHOOK, (void *) &lst)) {
 	active = 0;
+	comptimes[CT_TOTAL] = zmonotime() - start;
 	return 0;
     }
     /* Expand history references before starting completion.  If anything *
@@ -630,6 +651,7 @@ docomplete(int lst)
 
     if (doexpandhist()) {
 	active = 0;
+	comptimes[CT_TOTAL] = zmonotime() - start;
 	return 0;
     }
 
@@ -687,6 +709,7 @@ docomplete(int lst)
 	    unmetafy_line();
 	    zsfree(s);
 	    active = 0;
+	    comptimes[CT_TOTAL] = zmonotime() - start;
 	    makecommaspecial(0);
 	    return 1;
 	}
@@ -877,6 +900,7 @@ docomplete(int lst)
     unmetafy_line();
 
     active = 0;
+    comptimes[CT_TOTAL] = zmonotime() - start;
     makecommaspecial(0);
     return dat[1];
 }
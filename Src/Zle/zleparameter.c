@@ -99,6 +99,71 @@ scanpmwidgets(UNUSED(HashTable ht), ScanFunc func, int flags)
 	}
 }
 
+/* Functions for the comptimes special parameter. */
+
+static char *comptimenames[] = {
+    "function", "compadd", "sort", "list", "refresh", "total", "matches",
+    NULL
+};
+
+/**/
+static char *
+comptimestr(int i)
+{
+    char buf[DIGBUFSIZE + 16];
+
+    if (i == CT_NSTAGES)
+	sprintf(buf, "%d", comptimematches);
+    else
+	sprintf(buf, "%.6f", comptimes[i]);
+    return dupstring(buf);
+}
+
+/**/
+static HashNode
+getpmcomptimes(UNUSED(HashTable ht), const char *name)
+{
+    Param pm = NULL;
+    int i;
+
+    pm = (Param) hcalloc(sizeof(struct param));
+    pm->node.nam = dupstring(name);
+    pm->node.flags = PM_SCALAR | PM_READONLY;
+    pm->gsu.s = &nullsetscalar_gsu;
+
+    for (i = 0; comptimenames[i]; i++)
+	if (!strcmp(name, comptimenames[i]))
+	    break;
+    if (comptimenames[i])
+	pm->u.str = comptimestr(i);
+    else {
+	pm->u.str = dupstring("");
+	pm->node.flags |= PM_UNSET;
+    }
+    return &pm->node;
+}
+
+/**/
+static void
+scanpmcomptimes(UNUSED(HashTable ht), ScanFunc func, int flags)
+{
+    struct param pm;
+    int i;
+
+    memset((void *)&pm, 0, sizeof(struct param));
+    pm.node.flags = PM_SCALAR | PM_READONLY;
+    pm.gsu.s = &nullsetscalar_gsu;
+
+    for (i = 0; comptimenames[i]; i++) {
+	pm.node.nam = comptimenames[i];
+	if (func != scancountparams &&
+	    ((flags & (SCANPM_WANTVALS|SCANPM_MATCHVAL)) ||
+	     !(flags & SCANPM_WANTKEYS)))
+	    pm.u.str = comptimestr(i);
+	func(&pm.node, flags);
+    }
+}
+
 /* Functions for the zlekeymaps special parameter. */
 
 static char **
@@ -129,6 +194,8 @@ static const struct gsu_array keymaps_gsu =
 { keymapsgetfn, arrsetfn, stdunsetfn };
 
 static struct paramdef partab[] = {
+    SPECIALPMDEF("comptimes", PM_READONLY,
+		 &zlestdhash_gsu, getpmcomptimes, scanpmcomptimes),
     SPECIALPMDEF("keymaps", PM_ARRAY|PM_READONLY, &keymaps_gsu, NULL, NULL),
     SPECIALPMDEF("widgets", PM_READONLY,
 		 &zlestdhash_gsu, getpmwidgets, scanpmwidgets)
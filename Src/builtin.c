@@ -42,28 +42,28 @@ static struct builtin builtins[] =
     BIN_PREFIX("command", BINF_COMMAND),
     BIN_PREFIX("exec", BINF_EXEC),
     BIN_PREFIX("noglob", BINF_NOGLOB),
-    BUILTIN("[", BINF_HANDLES_OPTS, bin_test, 0, -1, BIN_BRACKET, NULL, NULL),
+    BUILTIN("[", BINF_HANDLES_OPTS | BINF_NOJOB, bin_test, 0, -1, BIN_BRACKET, NULL, NULL),
     BUILTIN(".", BINF_PSPECIAL, bin_dot, 1, -1, 0, NULL, NULL),
-    BUILTIN(":", BINF_PSPECIAL, bin_true, 0, -1, 0, NULL, NULL),
-    BUILTIN("alias", BINF_MAGICEQUALS | BINF_PLUSOPTS, bin_alias, 0, -1, 0, "Lgmrs", NULL),
+    BUILTIN(":", BINF_PSPECIAL | BINF_NOJOB, bin_true, 0, -1, 0, NULL, NULL),
+    BUILTIN("alias", BINF_MAGICEQUALS | BINF_PLUSOPTS | BINF_NOJOB, bin_alias, 0, -1, 0, "Lgmrs", NULL),
     BUILTIN("autoload", BINF_PLUSOPTS, bin_functions, 0, -1, 0, "mktTUwXz", "u"),
     BUILTIN("bg", 0, bin_fg, 0, -1, BIN_BG, NULL, NULL),
-    BUILTIN("break", BINF_PSPECIAL, bin_break, 0, 1, BIN_BREAK, NULL, NULL),
+    BUILTIN("break", BINF_PSPECIAL | BINF_NOJOB, bin_break, 0, 1, BIN_BREAK, NULL, NULL),
     BUILTIN("bye", 0, bin_break, 0, 1, BIN_EXIT, NULL, NULL),
     BUILTIN("cd", BINF_SKIPINVALID | BINF_SKIPDASH | BINF_DASHDASHVALID, bin_cd, 0, 2, BIN_CD, "qsPL", NULL),
     BUILTIN("chdir", BINF_SKIPINVALID | BINF_SKIPDASH | BINF_DASHDASHVALID, bin_cd, 0, 2, BIN_CD, "qsPL", NULL),
-    BUILTIN("continue", BINF_PSPECIAL, bin_break, 0, 1, BIN_CONTINUE, NULL, NULL),
-    BUILTIN("declare", BINF_PLUSOPTS | BINF_MAGICEQUALS | BINF_PSPECIAL, bin_typeset, 0, -1, 0, "AE:%F:%HL:%R:%TUZ:%afghi:%klmprtuxz", NULL),
-    BUILTIN("dirs", 0, bin_dirs, 0, -1, 0, "clpv", NULL),
+    BUILTIN("continue", BINF_PSPECIAL | BINF_NOJOB, bin_break, 0, 1, BIN_CONTINUE, NULL, NULL),
+    BUILTIN("declare", BINF_PLUSOPTS | BINF_MAGICEQUALS | BINF_PSPECIAL | BINF_NOJOB, bin_typeset, 0, -1, 0, "AE:%F:%HL:%R:%TUZ:%afghi:%klmprtuxz", NULL),
+    BUILTIN("dirs", BINF_NOJOB, bin_dirs, 0, -1, 0, "clpv", NULL),
     BUILTIN("disable", 0, bin_enable, 0, -1, BIN_DISABLE, "afmprs", NULL),
     BUILTIN("disown", 0, bin_fg, 0, -1, BIN_DISOWN, NULL, NULL),
-    BUILTIN("echo", BINF_SKIPINVALID, bin_print, 0, -1, BIN_ECHO, "neE", "-"),
+    BUILTIN("echo", BINF_SKIPINVALID | BINF_NOJOB, bin_print, 0, -1, BIN_ECHO, "neE", "-"),
     BUILTIN("emulate", 0, bin_emulate, 0, -1, 0, "LR", NULL),
     BUILTIN("enable", 0, bin_enable, 0, -1, BIN_ENABLE, "afmprs", NULL),
     BUILTIN("eval", BINF_PSPECIAL, bin_eval, 0, -1, BIN_EVAL, NULL, NULL),
     BUILTIN("exit", BINF_PSPECIAL, bin_break, 0, 1, BIN_EXIT, NULL, NULL),
-    BUILTIN("export", BINF_PLUSOPTS | BINF_MAGICEQUALS | BINF_PSPECIAL, bin_typeset, 0, -1, BIN_EXPORT, "E:%F:%HL:%R:%TUZ:%afhi:%lprtu", "xg"),
-    BUILTIN("false", 0, bin_false, 0, -1, 0, NULL, NULL),
+    BUILTIN("export", BINF_PLUSOPTS | BINF_MAGICEQUALS | BINF_PSPECIAL | BINF_NOJOB, bin_typeset, 0, -1, BIN_EXPORT, "E:%F:%HL:%R:%TUZ:%afhi:%lprtu", "xg"),
+    BUILTIN("false", BINF_NOJOB, bin_false, 0, -1, 0, NULL, NULL),
     /*
      * We used to behave as if the argument to -e was optional.
      * But that's actually not useful, so it's more consistent to
@@ -71,22 +71,23 @@ static struct builtin builtins[] =
      */
     BUILTIN("fc", 0, bin_fc, 0, -1, BIN_FC, "aAdDe:EfiIlmnpPrRt:W", NULL),
     BUILTIN("fg", 0, bin_fg, 0, -1, BIN_FG, NULL, NULL),
-    BUILTIN("float", BINF_PLUSOPTS | BINF_MAGICEQUALS | BINF_PSPECIAL, bin_typeset, 0, -1, 0, "E:%F:%HL:%R:%Z:%ghlprtux", "E"),
+    BUILTIN("float", BINF_PLUSOPTS | BINF_MAGICEQUALS | BINF_PSPECIAL | BINF_NOJOB, bin_typeset, 0, -1, 0, "E:%F:%HL:%R:%Z:%ghlprtux", "E"),
     BUILTIN("functions", BINF_PLUSOPTS, bin_functions, 0, -1, 0, "kmMtTuUz", NULL),
-    BUILTIN("getln", 0, bin_read, 0, -1, 0, "ecnAlE", "zr"),
-    BUILTIN("getopts", 0, bin_getopts, 2, -1, 0, NULL, NULL),
-    BUILTIN("hash", BINF_MAGICEQUALS, bin_hash, 0, -1, 0, "Ldfmrv", NULL),
+    BUILTIN("getln", BINF_NOJOB, bin_read, 0, -1, 0, "ecnAlE", "zr"),
+    BUILTIN("getopts", BINF_NOJOB, bin_getopts, 2, -1, 0, NULL, NULL),
+    BUILTIN("hash", BINF_MAGICEQUALS | BINF_NOJOB, bin_hash, 0, -1, 0, "Ldfmrv", NULL),
 
 #ifdef ZSH_HASH_DEBUG
     BUILTIN("hashinfo", 0, bin_hashinfo, 0, 0, 0, NULL, NULL),
 #endif
 
     BUILTIN("history", 0, bin_fc, 0, -1, BIN_FC, "adDEfimnpPrt:", "l"),
-    BUILTIN("integer", BINF_PLUSOPTS | BINF_MAGICEQUALS | BINF_PSPECIAL, bin_typeset, 0, -1, 0, "HL:%R:%Z:%ghi:%lprtux", "i"),
+    BUILTIN("integer", BINF_PLUSOPTS | BINF_MAGICEQUALS | BINF_PSPECIAL | BINF_NOJOB, bin_typeset, 0, -1, 0, "HL:%R:%Z:%ghi:%lprtux", "i"),
+    BUILTIN("jobpool", 0, bin_jobpool, 1, -1, 0, "a:j:n:o:", NULL),
     BUILTIN("jobs", 0, bin_fg, 0, -1, BIN_JOBS, "dlpZrs", NULL),
     BUILTIN("kill", BINF_HANDLES_OPTS, bin_kill, 0, -1, 0, NULL, NULL),
-    BUILTIN("let", 0, bin_let, 1, -1, 0, NULL, NULL),
-    BUILTIN("local", BINF_PLUSOPTS | BINF_MAGICEQUALS | BINF_PSPECIAL, bin_typeset, 0, -1, 0, "AE:%F:%HL:%R:%TUZ:%ahi:%lprtux", NULL),
+    BUILTIN("let", BINF_NOJOB, bin_let, 1, -1, 0, NULL, NULL),
+    BUILTIN("local", BINF_PLUSOPTS | BINF_MAGICEQUALS | BINF_PSPECIAL | BINF_NOJOB, bin_typeset, 0, -1, 0, "AE:%F:%HL:%R:%TUZ:%ahi:%lprtux", NULL),
     BUILTIN("log", 0, bin_log, 0, 0, 0, NULL, NULL),
     BUILTIN("logout", 0, bin_break, 0, 1, BIN_LOGOUT, NULL, NULL),
 
@@ -99,38 +100,38 @@ static struct builtin builtins[] =
 #endif
 
     BUILTIN("popd", BINF_SKIPINVALID | BINF_SKIPDASH | BINF_DASHDASHVALID, bin_cd, 0, 1, BIN_POPD, "q", NULL),
-    BUILTIN("print", BINF_PRINTOPTS, bin_print, 0, -1, BIN_PRINT, "abcC:Df:ilmnNoOpPrRsSu:z-", NULL),
-    BUILTIN("printf", 0, bin_print, 1, -1, BIN_PRINTF, NULL, NULL),
+    BUILTIN("print", BINF_PRINTOPTS | BINF_NOJOB, bin_print, 0, -1, BIN_PRINT, "abcC:Df:ilmnNoOpPrRsSu:z-", NULL),
+    BUILTIN("printf", BINF_NOJOB, bin_print, 1, -1, BIN_PRINTF, NULL, NULL),
     BUILTIN("pushd", BINF_SKIPINVALID | BINF_SKIPDASH | BINF_DASHDASHVALID, bin_cd, 0, 2, BIN_PUSHD, "qsPL", NULL),
-    BUILTIN("pushln", 0, bin_print, 0, -1, BIN_PRINT, NULL, "-nz"),
-    BUILTIN("pwd", 0, bin_pwd, 0, 0, 0, "rLP", NULL),
+    BUILTIN("pushln", BINF_NOJOB, bin_print, 0, -1, BIN_PRINT, NULL, "-nz"),
+    BUILTIN("pwd", BINF_NOJOB, bin_pwd, 0, 0, 0, "rLP", NULL),
     BUILTIN("r", 0, bin_fc, 0, -1, BIN_R, "nrl", NULL),
-    BUILTIN("read", 0, bin_read, 0, -1, 0, "cd:ek:%lnpqrst:%zu:AE", NULL),
-    BUILTIN("readonly", BINF_PLUSOPTS | BINF_MAGICEQUALS | BINF_PSPECIAL, bin_typeset, 0, -1, 0, "AE:%F:%HL:%R:%TUZ:%afghi:%lptux", "r"),
-    BUILTIN("rehash", 0, bin_hash, 0, 0, 0, "df", "r"),
-    BUILTIN("return", BINF_PSPECIAL, bin_break, 0, 1, BIN_RETURN, NULL, NULL),
-    BUILTIN("set", BINF_PSPECIAL | BINF_HANDLES_OPTS, bin_set, 0, -1, 0, NULL, NULL),
-    BUILTIN("setopt", 0, bin_setopt, 0, -1, BIN_SETOPT, NULL, NULL),
-    BUILTIN("shift", BINF_PSPECIAL, bin_shift, 0, -1, 0, NULL, NULL),
+    BUILTIN("read", BINF_NOJOB, bin_read, 0, -1, 0, "cd:ek:%lnpqrst:%zu:AE", NULL),
+    BUILTIN("readonly", BINF_PLUSOPTS | BINF_MAGICEQUALS | BINF_PSPECIAL | BINF_NOJOB, bin_typeset, 0, -1, 0, "AE:%F:%HL:%R:%TUZ:%afghi:%lptux", "r"),
+    BUILTIN("rehash", BINF_NOJOB, bin_hash, 0, 0, 0, "df", "r"),
+    BUILTIN("return", BINF_PSPECIAL | BINF_NOJOB, bin_break, 0, 1, BIN_RETURN, NULL, NULL),
+    BUILTIN("set", BINF_PSPECIAL | BINF_HANDLES_OPTS | BINF_NOJOB, bin_set, 0, -1, 0, NULL, NULL),
+    BUILTIN("setopt", BINF_NOJOB, bin_setopt, 0, -1, BIN_SETOPT, NULL, NULL),
+    BUILTIN("shift", BINF_PSPECIAL | BINF_NOJOB, bin_shift, 0, -1, 0, NULL, NULL),
     BUILTIN("source", BINF_PSPECIAL, bin_dot, 1, -1, 0, NULL, NULL),
     BUILTIN("suspend", 0, bin_suspend, 0, 0, 0, "f", NULL),
-    BUILTIN("test", BINF_HANDLES_OPTS, bin_test, 0, -1, BIN_TEST, NULL, NULL),
+    BUILTIN("test", BINF_HANDLES_OPTS | BINF_NOJOB, bin_test, 0, -1, BIN_TEST, NULL, NULL),
     BUILTIN("ttyctl", 0, bin_ttyctl, 0, 0, 0, "fu", NULL),
     BUILTIN("times", BINF_PSPECIAL, bin_times, 0, 0, 0, NULL, NULL),
     BUILTIN("trap", BINF_PSPECIAL | BINF_HANDLES_OPTS, bin_trap, 0, -1, 0, NULL, NULL),
-    BUILTIN("true", 0, bin_true, 0, -1, 0, NULL, NULL),
-    BUILTIN("type", 0, bin_whence, 0, -1, 0, "ampfsw", "v"),
-    BUILTIN("typeset", BINF_PLUSOPTS | BINF_MAGICEQUALS | BINF_PSPECIAL, bin_typeset, 0, -1, 0, "AE:%F:%HL:%R:%TUZ:%afghi:%klprtuxmz", NULL),
-    BUILTIN("umask", 0, bin_umask, 0, 1, 0, "S", NULL),
-    BUILTIN("unalias", 0, bin_unhash, 1, -1, 0, "ms", "a"),
-    BUILTIN("unfunction", 0, bin_unhash, 1, -1, 0, "m", "f"),
-    BUILTIN("unhash", 0, bin_unhash, 1, -1, 0, "adfms", NULL),
-    BUILTIN("unset", BINF_PSPECIAL, bin_unset, 1, -1, 0, "fmv", NULL),
-    BUILTIN("unsetopt", 0, bin_setopt, 0, -1, BIN_UNSETOPT, NULL, NULL),
+    BUILTIN("true", BINF_NOJOB, bin_true, 0, -1, 0, NULL, NULL),
+    BUILTIN("type", BINF_NOJOB, bin_whence, 0, -1, 0, "ampfsw", "v"),
+    BUILTIN("typeset", BINF_PLUSOPTS | BINF_MAGICEQUALS | BINF_PSPECIAL | BINF_NOJOB, bin_typeset, 0, -1, 0, "AE:%F:%HL:%R:%TUZ:%afghi:%klprtuxmz", NULL),
+    BUILTIN("umask", BINF_NOJOB, bin_umask, 0, 1, 0, "S", NULL),
+    BUILTIN("unalias", BINF_NOJOB, bin_unhash, 1, -1, 0, "ms", "a"),
+    BUILTIN("unfunction", BINF_NOJOB, bin_unhash, 1, -1, 0, "m", "f"),
+    BUILTIN("unhash", BINF_NOJOB, bin_unhash, 1, -1, 0, "adfms", NULL),
+    BUILTIN("unset", BINF_PSPECIAL | BINF_NOJOB, bin_unset, 1, -1, 0, "fmv", NULL),
+    BUILTIN("unsetopt", BINF_NOJOB, bin_setopt, 0, -1, BIN_UNSETOPT, NULL, NULL),
     BUILTIN("wait", 0, bin_fg, 0, -1, BIN_WAIT, NULL, NULL),
-    BUILTIN("whence", 0, bin_whence, 0, -1, 0, "acmpvfsw", NULL),
-    BUILTIN("where", 0, bin_whence, 0, -1, 0, "pmsw", "ca"),
-    BUILTIN("which", 0, bin_whence, 0, -1, 0, "ampsw", "c"),
+    BUILTIN("whence", BINF_NOJOB, bin_whence, 0, -1, 0, "acmpvfsw", NULL),
+    BUILTIN("where", BINF_NOJOB, bin_whence, 0, -1, 0, "pmsw", "ca"),
+    BUILTIN("which", BINF_NOJOB, bin_whence, 0, -1, 0, "ampsw", "c"),
     BUILTIN("zmodload", 0, bin_zmodload, 0, -1, 0, "AFRILP:abcfdilmpue", NULL),
     BUILTIN("zcompile", 0, bin_zcompile, 0, -1, 0, "tUMRcmzka", NULL),
 };
@@ -3815,6 +3816,11 @@ bin_print(char *name, char **args, Options ops, int func)
 		    zwarnnam(name, "-p: no coprocess");
 		    return 1;
 		}
+	    } else if (!idigit(*argptr) && isident(argptr)) {
+		if ((fdarg = getcoprocfd(argptr, 1)) < 0) {
+		    zwarnnam(name, "-u: no such coprocess: %s", argptr);
+		    return 1;
+		}
 	    } else {
 		fdarg = (int)zstrtol(argptr, &eptr, 10);
 		if (*eptr) {
@@ -4993,7 +4999,7 @@ eval(char **argv)
     } else
 	fpushed = 0;
 
-    prog = parse_string(zjoin(argv, ' ', 1), 1);
+    prog = parse_eval(zjoin(argv, ' ', 1));
     if (prog) {
 	if (wc_code(*prog->prog) != WC_LIST) {
 	    /* No code to execute */
@@ -5004,6 +5010,7 @@ eval(char **argv)
 	    if (errflag && !lastval)
 		lastval = errflag;
 	}
+	freeeprog(prog);
     } else {
 	lastval = 1;
     }
@@ -5170,6 +5177,130 @@ bin_eval(UNUSED(char *nam), char **argv, UNUSED(Options ops), UNUSED(int func))
 static char *zbuf;
 static int readfd;
 
+/*
+ * Input read ahead by read.  A regular file is read in blocks,
+ * starting small and doubling while the line goes on, and we seek
+ * back over anything unused before returning, so nothing else can
+ * tell.  Other input can't be put back, so there we only read ahead
+ * with READ_AHEAD set and keep what's left for the next read from the
+ * same file descriptor, recognised by device and inode in case the
+ * number has been reused in the meantime.
+ */
+
+#define READBUF_MIN	128
+#define READBUF_MAX	65536
+
+struct readbuf {
+    struct readbuf *next;
+    char *buf;
+    int size;		/* space allocated */
+    int chunk;		/* how much to read next time */
+    int pos;		/* next byte to return */
+    int len;		/* number of valid bytes */
+    int fd;
+    dev_t dev;
+    ino_t ino;
+};
+
+/* buffer in use by the current read, if any */
+static struct readbuf *readbuf;
+/* buffer for regular files, reused between reads */
+static struct readbuf seekbuf;
+/* buffers holding input left over from pipes etc. */
+static struct readbuf *readaheads;
+
+/*
+ * Find or set up the buffer for input from fd.  An existing buffer
+ * with input left over is always used; a new one only if fill is set.
+ */
+
+/**/
+static void
+readbuf_start(int fd, int fill)
+{
+    struct stat st;
+    struct readbuf *rb;
+
+    readbuf = NULL;
+    if (fd < 0 || fstat(fd, &st) < 0)
+	return;
+    for (rb = readaheads; rb; rb = rb->next) {
+	if (rb->fd == fd && rb->dev == st.st_dev && rb->ino == st.st_ino) {
+	    readbuf = rb;
+	    return;
+	}
+    }
+    if (!fill || isatty(fd))
+	return;
+    if (S_ISREG(st.st_mode)) {
+	if (lseek(fd, 0, SEEK_CUR) == (off_t)-1)
+	    return;
+	rb = &seekbuf;
+	rb->chunk = READBUF_MIN;
+    } else if (isset(READAHEAD)) {
+	rb = (struct readbuf *)zshcalloc(sizeof(struct readbuf));
+	rb->chunk = READBUF_MAX;
+	rb->next = readaheads;
+	readaheads = rb;
+    } else
+	return;
+    rb->fd = fd;
+    rb->dev = st.st_dev;
+    rb->ino = st.st_ino;
+    rb->pos = rb->len = 0;
+    readbuf = rb;
+}
+
+/*
+ * Finished with the buffer for this read: put back what we didn't
+ * use, or forget the buffer if there's nothing left in it.
+ */
+
+/**/
+static void
+readbuf_finish(void)
+{
+    struct readbuf *rb = readbuf, **rbp;
+
+    if (!rb)
+	return;
+    readbuf = NULL;
+    if (rb == &seekbuf) {
+	if (rb->pos < rb->len)
+	    lseek(rb->fd, (off_t)(rb->pos - rb->len), SEEK_CUR);
+	rb->pos = rb->len = 0;
+	return;
+    }
+    if (rb->pos < rb->len)
+	return;
+    for (rbp = &readaheads; *rbp; rbp = &(*rbp)->next) {
+	if (*rbp == rb) {
+	    *rbp = rb->next;
+	    break;
+	}
+    }
+    if (rb->buf)
+	zfree(rb->buf, rb->size);
+    zfree(rb, sizeof(struct readbuf));
+}
+
+/* Take up to len bytes already buffered for the current read. */
+
+/**/
+static int
+readbuf_take(char *buf, int len)
+{
+    struct readbuf *rb = readbuf;
+
+    if (!rb || rb->pos == rb->len)
+	return 0;
+    if (len > rb->len - rb->pos)
+	len = rb->len - rb->pos;
+    memcpy(buf, rb->buf + rb->pos, len);
+    rb->pos += len;
+    return len;
+}
+
 /* Read a character from readfd, or from the buffer zbuf.  Return EOF on end of
 file/buffer. */
 
@@ -5265,6 +5396,11 @@ bin_read(char *name, char **args, Options ops, UNUSED(int func))
 		zwarnnam(name, "-p: no coprocess");
 		return 1;
 	    }
+	} else if (!idigit(*argptr) && isident(argptr)) {
+	    if ((readfd = getcoprocfd(argptr, 0)) < 0) {
+		zwarnnam(name, "-u: no such coprocess: %s", argptr);
+		return 1;
+	    }
 	} else {
 	    readfd = (int)zstrtol(argptr, &eptr, 10);
 	    if (*eptr) {
@@ -5349,13 +5485,18 @@ bin_read(char *name, char **args, Options ops, UNUSED(int func))
 	    settyinfo(&ti);
 	}
     }
+    if (!izle && !OPT_ISSET(ops,'z'))
+	readbuf_start(readfd, !keys &&
+		      !OPT_ISSET(ops,'k') && !OPT_ISSET(ops,'q'));
     if (OPT_ISSET(ops,'t')) {
 	zlong timeout = 0;
 	if (OPT_HASARG(ops,'t')) {
 	    mnumber mn = zero_mnumber;
 	    mn = matheval(OPT_ARG(ops,'t'));
-	    if (errflag)
+	    if (errflag) {
+		readbuf_finish();
 		return 1;
+	    }
 	    if (mn.type == MN_FLOAT) {
 		mn.u.d *= 1e6;
 		timeout = (zlong)mn.u.d;
@@ -5377,8 +5518,10 @@ bin_read(char *name, char **args, Options ops, UNUSED(int func))
 #endif
 	} else {
 	    if (readfd == -1 ||
-		!read_poll(readfd, &readchar, keys && !zleactive,
-			   timeout)) {
+		((!readbuf || readbuf->pos == readbuf->len) &&
+		 !read_poll(readfd, &readchar, keys && !zleactive,
+			    timeout))) {
+		readbuf_finish();
 		if (keys && !zleactive && !isem)
 		    settyinfo(&shttyinfo);
 		else if (resettty && SHTTY != -1)
@@ -5441,7 +5584,7 @@ bin_read(char *name, char **args, Options ops, UNUSED(int func))
 		    *bptr = readchar;
 		    val = 1;
 		    readchar = -1;
-		} else {
+		} else if (!(val = readbuf_take(bptr, nchars))) {
 		    while ((val = read(readfd, bptr, nchars)) < 0) {
 			if (errno != EINTR ||
 			    errflag || retflag || breaks || contflag)
@@ -5524,6 +5667,7 @@ bin_read(char *name, char **args, Options ops, UNUSED(int func))
 	    zfree(buf, bptr - buf + 1);
 	if (resettty && SHTTY != -1)
 	    settyinfo(&saveti);
+	readbuf_finish();
 	return eof;
     }
 
@@ -5705,6 +5849,7 @@ bin_read(char *name, char **args, Options ops, UNUSED(int func))
     }
     /* handle EOF */
     if (c == EOF) {
+	readbuf_finish();
 	if (readfd == coprocin) {
 	    close(coprocin);
 	    close(coprocout);
@@ -5716,6 +5861,7 @@ bin_read(char *name, char **args, Options ops, UNUSED(int func))
 	char **pp, **p = NULL;
 	LinkNode n;
 
+	readbuf_finish();
 	p = (OPT_ISSET(ops,'e') ? (char **)NULL
 	     : (char **)zalloc((al + 1) * sizeof(char *)));
 
@@ -5843,6 +5989,7 @@ bin_read(char *name, char **args, Options ops, UNUSED(int func))
 	}
 	signal_setmask(s);
     }
+    readbuf_finish();
 #ifdef MULTIBYTE_SUPPORT
     if (ret != MB_INCOMPLETE)
 	bptr = laststart;
@@ -5895,13 +6042,48 @@ bin_read(char *name, char **args, Options ops, UNUSED(int func))
     return errflag;
 }
 
+/* Read up to len bytes from readfd, retrying if interrupted. */
+
 /**/
 static int
-zread(int izle, int *readchar, long izle_timeout)
+zreadraw(char *buf, int len)
 {
-    char cc, retry = 0;
+    char retry = 0;
     int ret;
 
+    for (;;) {
+	ret = read(readfd, buf, len);
+	if (ret >= 0)
+	    return ret;
+#if defined(EAGAIN) || defined(EWOULDBLOCK)
+	if (!retry && readfd == 0 && (
+# ifdef EAGAIN
+	    errno == EAGAIN
+#  ifdef EWOULDBLOCK
+	    ||
+#  endif /* EWOULDBLOCK */
+# endif /* EAGAIN */
+# ifdef EWOULDBLOCK
+	    errno == EWOULDBLOCK
+# endif /* EWOULDBLOCK */
+	    ) && setblock_stdin()) {
+	    retry = 1;
+	    continue;
+	} else
+#endif /* EAGAIN || EWOULDBLOCK */
+	    if (errno == EINTR && !(errflag || retflag || breaks || contflag))
+		continue;
+	return -1;
+    }
+}
+
+/**/
+static int
+zread(int izle, int *readchar, long izle_timeout)
+{
+    struct readbuf *rb;
+    char cc;
+
     if (izle) {
 	int c;
 	zleentry(ZLE_CMD_GET_KEY, izle_timeout, NULL, &c);
@@ -5923,36 +6105,25 @@ zread(int izle, int *readchar, long izle_timeout)
 	*readchar = -1;
 	return STOUC(cc);
     }
-    for (;;) {
-	/* read a character from readfd */
-	ret = read(readfd, &cc, 1);
-	switch (ret) {
-	case 1:
-	    /* return the character read */
-	    return STOUC(cc);
-	case -1:
-#if defined(EAGAIN) || defined(EWOULDBLOCK)
-	    if (!retry && readfd == 0 && (
-# ifdef EAGAIN
-		errno == EAGAIN
-#  ifdef EWOULDBLOCK
-		||
-#  endif /* EWOULDBLOCK */
-# endif /* EAGAIN */
-# ifdef EWOULDBLOCK
-		errno == EWOULDBLOCK
-# endif /* EWOULDBLOCK */
-		) && setblock_stdin()) {
-		retry = 1;
-		continue;
-	    } else
-#endif /* EAGAIN || EWOULDBLOCK */
-		if (errno == EINTR && !(errflag || retflag || breaks || contflag))
-		    continue;
-	    break;
+    if ((rb = readbuf)) {
+	if (rb->pos == rb->len) {
+	    /* empty: read the next block, larger each time for a file */
+	    if (rb == &seekbuf && rb->len && rb->chunk < READBUF_MAX)
+		rb->chunk *= 2;
+	    if (rb->chunk > rb->size) {
+		if (rb->buf)
+		    zfree(rb->buf, rb->size);
+		rb->buf = (char *)zalloc(rb->size = rb->chunk);
+	    }
+	    rb->pos = rb->len = 0;
+	    if ((rb->len = zreadraw(rb->buf, rb->chunk)) <= 0) {
+		rb->len = 0;
+		return EOF;
+	    }
 	}
-	return EOF;
+	return STOUC(rb->buf[rb->pos++]);
     }
+    return zreadraw(&cc, 1) == 1 ? STOUC(cc) : EOF;
 }
 
 /* holds arguments for testlex() */
@@ -90,6 +90,32 @@ difftime(time_t t2, time_t t1)
 #endif
 
 
+/*
+ * Get a time stamp in seconds for measuring intervals, from a clock
+ * unaffected by changes to the system time if there is one.
+ */
+
+/**/
+mod_export double
+zmonotime(void)
+{
+#if defined(HAVE_CLOCK_GETTIME) && defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+
+    if (!clock_gettime(CLOCK_MONOTONIC, &ts))
+	return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+    else
+#endif
+    {
+	struct timeval tv;
+	struct timezone dummy;
+
+	gettimeofday(&tv, &dummy);
+	return (double) tv.tv_sec + (double) tv.tv_usec / 1e6;
+    }
+}
+
+
 #ifndef HAVE_STRERROR
 extern char *sys_errlist[];
 
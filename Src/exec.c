@@ -54,6 +54,11 @@ int noerrexit;
 /**/
 mod_export int noerrs;
 
+/* counts of events in the shell, indexed by PC_* */
+
+/**/
+mod_export zlong perfcounts[PC_COUNT];
+
 /* do not save history on exec and exit */
 
 /**/
@@ -136,6 +141,13 @@ mod_export int coprocin;
 /**/
 mod_export int coprocout;
 
+/*
+ * Set when forking a coprocess, so that the child closes the shell's
+ * ends of named coprocesses.
+ */
+
+static int forkcoproc;
+
 /* count of file locks recorded in fdtable */
 
 /**/
@@ -195,6 +207,158 @@ static int doneps4;
 static char *STTYval;
 static char *blank_env[] = { NULL };
 
+/* File descriptor for the command trace, $ZSH_TRACEFD; 0 if none. */
+
+/**/
+zlong zsh_tracefd;
+
+/*
+ * The record for the command trace of a pipeline being executed.  The
+ * words of its commands are added by execcmd() and the record is written
+ * by execpline() when the pipeline has finished.
+ */
+
+struct cmdtrace {
+    double start;
+    int subsh;			/* $ZSH_SUBSHELL, to ignore it in subshells */
+    char *words;		/* permanently allocated, NULL if none yet */
+    char *func;
+    char *file;
+    zlong line;
+};
+
+static struct cmdtrace *cmdtrace;
+
+/*
+ * Add the words of a command to the trace of the pipeline.  The location
+ * is that of the first command, found like the %x and %I prompt escapes.
+ */
+
+static void
+addcmdtrace(LinkList args)
+{
+    LinkNode node;
+    char *s;
+
+    if (!args || !firstnode(args))
+	return;
+    if (!cmdtrace->words) {
+	cmdtrace->words = ztrdup("");
+	cmdtrace->line = lineno;
+	if (funcstack && funcstack->tp != FS_SOURCE && !IN_EVAL_TRAP()) {
+	    cmdtrace->func = funcstack->name;
+	    cmdtrace->file = funcstack->filename;
+	    cmdtrace->line += funcstack->flineno;
+	    if (funcstack->tp == FS_EVAL)
+		cmdtrace->line--;
+	} else {
+	    cmdtrace->func = funcstack ? funcstack->name : NULL;
+	    cmdtrace->file = scriptfilename ? scriptfilename : argzero;
+	}
+    } else
+	cmdtrace->words = appstr(cmdtrace->words, " |");
+    /* Quote words as ${(q-)...} would, but keep a record on one line. */
+    for (node = firstnode(args); node; incnode(node)) {
+	s = (char *) getdata(node);
+	if (!*s)
+	    s = "''";
+	else if (hasspecial(s)) {
+	    char *t;
+
+	    for (t = s; *t; t++)
+		if (*t == '\n' || *t == '\t' || *t == '\r')
+		    break;
+	    if (*t)
+		s = zhtricat("$'", quotestring(s, NULL, QT_DOLLARS), "'");
+	    else
+		s = quotestring(s, NULL, QT_SINGLE_OPTIONAL);
+	}
+	cmdtrace->words = appstr(appstr(cmdtrace->words, " "), s);
+    }
+}
+
+/*
+ * A forked command is only expanded in the child, which sends the words
+ * it runs to the parent for the trace, each terminated by a null.
+ */
+
+static void
+sendcmdtrace(int fd, LinkList args)
+{
+    LinkNode node;
+    char *s;
+
+    for (node = firstnode(args); node; incnode(node)) {
+	s = (char *) getdata(node);
+	write_loop(fd, s, strlen(s) + 1);
+    }
+}
+
+/*
+ * Read the words sent by sendcmdtrace() until the child closes the pipe.
+ * If there are none, because expansion failed, use the unexpanded
+ * words in args.
+ */
+
+static LinkList
+recvcmdtrace(int fd, LinkList args)
+{
+    LinkList words = newlinklist();
+    LinkNode node;
+    size_t size = 256, len = 0;
+    ssize_t count;
+    char *buf = (char *) zalloc(size), *s, *e;
+
+    for (;;) {
+	if (len == size)
+	    buf = (char *) zrealloc(buf, size *= 2);
+	if ((count = read(fd, buf + len, size - len)) > 0)
+	    len += count;
+	else if (!count || errno != EINTR)
+	    break;
+    }
+    for (s = buf; s < buf + len && (e = memchr(s, '\0', buf + len - s));
+	 s = e + 1)
+	addlinknode(words, dupstring(s));
+    zfree(buf, size);
+    if (empty(words) && args)
+	for (node = firstnode(args); node; incnode(node)) {
+	    s = dupstring((char *) getdata(node));
+	    untokenize(s);
+	    addlinknode(words, s);
+	}
+    return words;
+}
+
+/* Write the trace record of a pipeline, if it ran any commands. */
+
+static void
+endcmdtrace(struct cmdtrace *ct, int status, int async)
+{
+    char buf[DIGBUFSIZE * 3 + 10], *rec;
+    int len;
+
+    if (!ct->words)
+	return;
+    if (ct->subsh == zsh_subshell && zsh_tracefd > 0) {
+	sprintf(buf, "%.6f\t%.6f\t%d\t", ct->start, zmonotime() - ct->start,
+		status);
+	rec = zhtricat(buf, ct->func ? ct->func : "", "\t");
+	rec = zhtricat(rec, ct->file ? ct->file : "", "\t");
+#if defined(ZLONG_IS_LONG_LONG) && defined(PRINTF_HAS_LLD)
+	sprintf(buf, "%lld\t", ct->line);
+#else
+	sprintf(buf, "%ld\t", (long)ct->line);
+#endif
+	/* The words start with a space. */
+	rec = zhtricat(rec, buf, ct->words + 1);
+	rec = dyncat(rec, async ? " &\n" : "\n");
+	unmetafy(rec, &len);
+	write_loop((int)zsh_tracefd, rec, len);
+    }
+    zsfree(ct->words);
+}
+
 /* Execution functions. */
 
 static int (*execfuncs[WC_COUNT-WC_CURSH]) _((Estate, int)) = {
@@ -216,6 +380,7 @@ parse_string(char *s, int reset_lineno)
     Eprog p;
     zlong oldlineno;
 
+    perfcounts[PC_PARSE]++;
     lexsave();
     inpush(s, INP_LINENO, NULL);
     strinbeg(0);
@@ -297,6 +462,7 @@ zfork(struct timeval *tv)
      * zippy anyway.
      */
     queue_signals();
+    perfcounts[PC_FORK]++;
     pid = fork();
     unqueue_signals();
     if (pid == -1) {
@@ -454,6 +620,8 @@ zexecve(char *pth, char **argv, char **newenvp)
 
     if (newenvp == NULL)
 	    newenvp = environ;
+    /* Let modules undo anything that shouldn't survive into the new program */
+    runhookdef(BEFOREEXECHOOK, NULL);
     winch_unblock();
     execve(pth, argv, newenvp);
 
@@ -526,6 +694,7 @@ zexecve(char *pth, char **argv, char **newenvp)
 	} else
 	    eno = errno;
     }
+    runhookdef(AFTEREXECHOOK, NULL);
     /* restore the original arguments and path but do not bother with *
      * null characters as these cannot be passed to external commands *
      * anyway.  So the result is truncated at the first null char.    */
@@ -930,6 +1099,10 @@ entersubsh(int flags)
 	    if (!(sigtrapped[sig] & ZSIG_FUNC) &&
 		sig != SIGDEBUG && sig != SIGZERR)
 		unsettrap(sig);
+    if (forkcoproc) {
+	closem(FDT_COPROC);
+	forkcoproc = 0;
+    }
     monitor = isset(MONITOR);
     job_control_ok = monitor && (flags & ESUB_JOB_CONTROL) && isset(POSIXJOBS);
     if (flags & ESUB_NOMONITOR)
@@ -1401,6 +1574,55 @@ sublist_done:
     }
 }
 
+/*
+ * Make the file descriptors of a named coprocess available to the
+ * user:  name is set to an array of the descriptor for reading from
+ * the coprocess and the one for writing to it, and name_PID to its
+ * process ID.  The descriptors may be used like those opened with
+ * the {name}>file syntax, except that they aren't passed on to
+ * external commands or other coprocesses.
+ */
+
+/**/
+static void
+setcoprocparams(char *name, int infd, int outfd)
+{
+    char **fds = (char **)zalloc(3 * sizeof(char *));
+    char buf[DIGBUFSIZE], *pidname;
+
+    sprintf(buf, "%d", infd);
+    fds[0] = ztrdup(buf);
+    sprintf(buf, "%d", outfd);
+    fds[1] = ztrdup(buf);
+    fds[2] = NULL;
+    if (!setaparam(name, fds)) {
+	zclose(infd);
+	zclose(outfd);
+	return;
+    }
+    pidname = zhtricat(name, "_PID", "");
+    setiparam(pidname, lastpid);
+}
+
+/*
+ * Return the file descriptor for reading from the named coprocess name,
+ * or for writing to it if out is set, or -1 if there isn't one.
+ */
+
+/**/
+mod_export int
+getcoprocfd(char *name, int out)
+{
+    char **fds, *eptr;
+    int fd;
+
+    if (idigit(*name) || !isident(name) || !(fds = getaparam(name)) ||
+	arrlen(fds) != 2)
+	return -1;
+    fd = (int)zstrtol(fds[out ? 1 : 0], &eptr, 10);
+    return (*eptr || fd < 0) ? -1 : fd;
+}
+
 /* Execute a pipeline.                                                *
  * last1 is a flag that this command is the last command in a shell   *
  * that is about to exit, so we can exec instead of forking.  It gets *
@@ -1419,14 +1641,28 @@ execpline(Estate state, wordcode slcode, int how, int last1)
     int pj, newjob;
     int old_simple_pline = simple_pline;
     int slflags = WC_SUBLIST_FLAGS(slcode);
-    wordcode code = *state->pc++;
+    char *coprocname = NULL;
+    wordcode code;
+    struct cmdtrace ct, *oldcmdtrace = cmdtrace;
     static int lastwj, lpforked;
 
+    if (slflags & WC_SUBLIST_NAMED)
+	coprocname = ecgetstr(state, EC_DUP, NULL);
+    code = *state->pc++;
+
     if (wc_code(code) != WC_PIPE)
 	return lastval = (slflags & WC_SUBLIST_NOT) != 0;
     else if (slflags & WC_SUBLIST_NOT)
 	last1 = 0;
 
+    if (WC_PIPE_TYPE(code) == WC_PIPE_END && !(how & (Z_ASYNC|Z_TIMED)) &&
+	!(slflags & WC_SUBLIST_COPROC) && !coprocname &&
+	execsimplebuiltin(state, code)) {
+	if ((slflags & WC_SUBLIST_NOT) && !errflag)
+	    lastval = !lastval;
+	return lastval;
+    }
+
     pj = thisjob;
     ipipe[0] = ipipe[1] = opipe[0] = opipe[1] = 0;
     child_block();
@@ -1441,10 +1677,37 @@ execpline(Estate state, wordcode slcode, int how, int last1)
 	child_unblock();
 	return 1;
     }
+    if (zsh_tracefd > 0) {
+	ct.start = zmonotime();
+	ct.subsh = zsh_subshell;
+	ct.words = NULL;
+	cmdtrace = &ct;
+    } else
+	cmdtrace = NULL;
     if (how & Z_TIMED)
 	jobtab[thisjob].stat |= STAT_TIMED;
 
-    if (slflags & WC_SUBLIST_COPROC) {
+    if (coprocname) {
+	/*
+	 * A named coprocess doesn't replace the anonymous one;
+	 * its file descriptors are handed to the user afterwards.
+	 */
+	how = Z_ASYNC;
+	if (mpipe(ipipe) < 0) {
+	    slflags &= ~WC_SUBLIST_COPROC;
+	} else if (mpipe(opipe) < 0) {
+	    zclose(ipipe[0]);
+	    zclose(ipipe[1]);
+	    ipipe[0] = ipipe[1] = 0;
+	    slflags &= ~WC_SUBLIST_COPROC;
+	} else {
+	    fdtable[ipipe[0]] = fdtable[opipe[1]] = FDT_COPROC;
+#ifdef FD_CLOEXEC
+	    fcntl(ipipe[0], F_SETFD, FD_CLOEXEC);
+	    fcntl(opipe[1], F_SETFD, FD_CLOEXEC);
+#endif
+	}
+    } else if (slflags & WC_SUBLIST_COPROC) {
 	how = Z_ASYNC;
 	if (coprocin >= 0) {
 	    zclose(coprocin);
@@ -1475,7 +1738,9 @@ execpline(Estate state, wordcode slcode, int how, int last1)
 	list_pipe_job = newjob;
     }
     lastwj = lpforked = 0;
+    forkcoproc = (slflags & WC_SUBLIST_COPROC) != 0;
     execpline2(state, code, how, opipe[0], ipipe[1], last1);
+    forkcoproc = 0;
     pline_level--;
     if (how & Z_ASYNC) {
 	lastwj = newjob;
@@ -1486,6 +1751,8 @@ execpline(Estate state, wordcode slcode, int how, int last1)
 	if (slflags & WC_SUBLIST_COPROC) {
 	    zclose(ipipe[1]);
 	    zclose(opipe[0]);
+	    if (coprocname)
+		setcoprocparams(coprocname, ipipe[0], opipe[1]);
 	}
 	if (how & Z_DISOWN) {
 	    deletejob(jobtab + thisjob, 1);
@@ -1494,6 +1761,9 @@ execpline(Estate state, wordcode slcode, int how, int last1)
 	else
 	    spawnjob();
 	child_unblock();
+	if (cmdtrace)
+	    endcmdtrace(cmdtrace, 0, 1);
+	cmdtrace = oldcmdtrace;
 	/* Executing background code resets shell status */
 	return lastval = 0;
     } else {
@@ -1658,6 +1928,9 @@ execpline(Estate state, wordcode slcode, int how, int last1)
     }
     if (!pline_level)
 	simple_pline = old_simple_pline;
+    if (cmdtrace)
+	endcmdtrace(cmdtrace, lastval, 0);
+    cmdtrace = oldcmdtrace;
     return lastval;
 }
 
@@ -2384,6 +2657,128 @@ resolvebuiltin(const char *cmdarg, HashNode hn)
     return hn;
 }
 
+/*
+ * Execute a pipeline consisting of nothing but a builtin with the
+ * BINF_NOJOB flag, without assignments or redirections, whose name is
+ * a literal and whose arguments need no command or process substitution
+ * or anything else that might fork.  This is the commonest shape of
+ * command in loops, and everything execpline() and execcmd() would do
+ * for it beyond expanding the words and calling the builtin (the job
+ * table entry, blocking SIGCHLD, the redirection and fork decisions)
+ * has no visible effect, so it is run here directly much as execsimple()
+ * runs current shell constructs.  Returns 1 with lastval set if the
+ * command was executed, otherwise 0 leaving the state untouched for
+ * execpline() to do it the long way.
+ */
+
+/**/
+static int
+execsimplebuiltin(Estate state, wordcode pcode)
+{
+    Wordcode pc = state->pc;
+    wordcode code = *pc;
+    HashNode hn;
+    LinkList args;
+    char *cmdarg, *s, *e;
+    int argc, i, pj, htok = 0;
+
+    if (wc_code(code) != WC_SIMPLE || !(argc = WC_SIMPLE_ARGC(code)) ||
+	(pc[1] & 1) || isset(XTRACE) || zsh_tracefd > 0 || isset(AUTORESUME) ||
+	list_pipe_child || (pline_level && (jobbing || nowait)))
+	return 0;
+    for (i = 2; i <= argc; i++) {
+	if (!(pc[i] & 1))	/* string contains no tokens */
+	    continue;
+	htok = 1;
+	for (cmdarg = s = ecrawstr(state->prog, pc + i, NULL); *s; s++) {
+	    if (*s == Tick || *s == Qtick)
+		return 0;
+	    /*
+	     * Apart from $((...)), recognised the same way as in
+	     * stringsubst(), a parenthesis may introduce a command or
+	     * process substitution, or glob qualifiers or parameter flags
+	     * that can run commands.
+	     */
+	    if (*s == Inpar) {
+		if (s == cmdarg || (s[-1] != String && s[-1] != Qstring) ||
+		    s[1] != '(')
+		    return 0;
+		e = s;
+		if (skipparens(Inpar, Outpar, &e) || e[-2] != ')')
+		    return 0;
+	    }
+	}
+    }
+    cmdarg = ecrawstr(state->prog, pc + 1, NULL);
+    if (*cmdarg == '%' || shfunctab->getnode(shfunctab, cmdarg) ||
+	!(hn = builtintab->getnode(builtintab, cmdarg)) ||
+	!(hn->flags & BINF_NOJOB) || !((Builtin) hn)->handlerfunc)
+	return 0;
+
+    pj = thisjob;
+    if (breaks || retflag)
+	goto done;
+
+    /* In evaluated traps, don't modify the line number. */
+    if (!IN_EVAL_TRAP() && !ineval && WC_PIPE_LINENO(pcode))
+	lineno = WC_PIPE_LINENO(pcode) - 1;
+    doneps4 = 0;
+    state->pc++;
+    args = ecgetlist(state, argc, EC_DUP, NULL);
+    thisjob = -1;
+
+    esprefork = ((hn->flags & BINF_MAGICEQUALS) || isset(MAGICEQUALSUBST)) ?
+	PREFORK_TYPESET : 0;
+    if (htok)
+	prefork(args, esprefork);
+    if (errflag) {
+	lastval = 1;
+	goto done;
+    }
+    setunderscore((char *) getdata(lastnode(args)));
+    esglob = 1;
+    if (htok)
+	globlist(args, 0);
+    if (errflag)
+	lastval = 1;
+    else {
+	fflush(xtrerr);
+	if (isset(EXECOPT)) {
+	    lastval = execbuiltin(args, (Builtin) hn);
+	    fflush(stdout);
+	    if (ferror(stdout)) {
+		zwarn("write error: %e", errno);
+		clearerr(stdout);
+	    }
+	    if (isset(PRINTEXITVALUE) && isset(SHINSTDIN) &&
+		lastval && !subsh) {
+#if defined(ZLONG_IS_LONG_LONG) && defined(PRINTF_HAS_LLD)
+		fprintf(stderr, "zsh: exit %lld\n", lastval);
+#else
+		fprintf(stderr, "zsh: exit %ld\n", (long)lastval);
+#endif
+		fflush(stderr);
+	    }
+	}
+    }
+    if (isset(POSIXBUILTINS) && (hn->flags & BINF_PSPECIAL) && errflag) {
+	if (!isset(INTERACTIVE))
+	    exit(1);
+	errflag = 1;
+    }
+
+ done:
+    thisjob = pj;
+    state->pc = pc + argc + 1;
+
+    /* What waitjobs() and execpline() do with a job without processes. */
+    pipestats[0] = lastval;
+    numpipestats = 1;
+    if (list_pipe && (lastval & 0200) && pj >= 0 && jobtab[pj].gleader)
+	killjb(jobtab + pj, lastval & ~0200);
+    return 1;
+}
+
 /**/
 static void
 execcmd(Estate state, int input, int output, int how, int last1)
@@ -2396,7 +2791,7 @@ execcmd(Estate state, int input, int output, int how, int last1)
     char *text;
     int save[10];
     int fil, dfil, is_cursh, type, do_exec = 0, redir_err = 0, i, htok = 0;
-    int nullexec = 0, assign = 0, forked = 0;
+    int nullexec = 0, assign = 0, forked = 0, tracefd = -1;
     int is_shfunc = 0, is_builtin = 0, is_exec = 0, use_defpath = 0;
     /* Various flags to the command. */
     int cflags = 0, orig_cflags = 0, checked = 0, oautocont = -1;
@@ -2832,6 +3227,9 @@ execcmd(Estate state, int input, int output, int how, int last1)
 
     /* This is nonzero if the command is a current shell procedure? */
     is_cursh = (is_builtin || is_shfunc || nullexec || type >= WC_CURSH);
+    /* Counted here, as it's usually a child that executes the command. */
+    if (type == WC_SIMPLE && !is_cursh)
+	perfcounts[PC_EXEC]++;
 
     /**************************************************************************
      * Do we need to fork?  We need to fork if:                               *
@@ -2858,7 +3256,7 @@ execcmd(Estate state, int input, int output, int how, int last1)
 	(!do_exec &&
 	 (((is_builtin || is_shfunc) && output) ||
 	  (!is_cursh && (last1 != 1 || nsigtrapped || havefiles() ||
-			 fdtable_flocks))))) {
+			 fdtable_flocks || cmdtrace))))) {
 
 	pid_t pid;
 	int synch[2], flags;
@@ -2877,9 +3275,13 @@ execcmd(Estate state, int input, int output, int how, int last1)
 	    goto fatal;
 	}
 	if (pid) {
+	    LinkList tracewords = NULL;
 
 	    close(synch[1]);
-	    read_loop(synch[0], &dummy, 1);
+	    if (cmdtrace)
+		tracewords = recvcmdtrace(synch[0], args);
+	    else
+		read_loop(synch[0], &dummy, 1);
 	    close(synch[0]);
 	    if (how & Z_ASYNC) {
 		lastpid = (zlong) pid;
@@ -2902,6 +3304,8 @@ execcmd(Estate state, int input, int output, int how, int last1)
 	    addproc(pid, text, 0, &bgtime);
 	    if (oautocont >= 0)
 		opts[AUTOCONTINUE] = oautocont;
+	    if (tracewords)
+		addcmdtrace(tracewords);
 	    return;
 	}
 	/* pid == 0 */
@@ -2913,7 +3317,11 @@ execcmd(Estate state, int input, int output, int how, int last1)
 	    flags |= ESUB_JOB_CONTROL;
 	filelist = jobtab[thisjob].filelist;
 	entersubsh(flags);
-	close(synch[1]);
+	/* Hold the parent until the words to trace are sent. */
+	if (cmdtrace)
+	    tracefd = synch[1];
+	else
+	    close(synch[1]);
 	forked = 1;
 	if (sigtrapped[SIGINT] & ZSIG_IGNORED)
 	    holdintr();
@@ -2949,6 +3357,13 @@ execcmd(Estate state, int input, int output, int how, int last1)
 	lastval = 1;
 	goto err;
     }
+    if (tracefd >= 0) {
+	if (args)
+	    sendcmdtrace(tracefd, args);
+	close(tracefd);
+	tracefd = -1;
+    } else if (cmdtrace && !forked)
+	addcmdtrace(args);
 
     /* Make a copy of stderr for xtrace output before redirecting */
     fflush(xtrerr);
@@ -3119,7 +3534,8 @@ execcmd(Estate state, int input, int output, int how, int last1)
 			  */
 			 (fn->fd2 <= max_zsh_fd &&
 			  ((fdtable[fn->fd2] != FDT_UNUSED &&
-			    fdtable[fn->fd2] != FDT_EXTERNAL) ||
+			    fdtable[fn->fd2] != FDT_EXTERNAL &&
+			    fdtable[fn->fd2] != FDT_COPROC) ||
 			   fn->fd2 == coprocin ||
 			   fn->fd2 == coprocout))) {
 		    fil = -1;
@@ -3644,6 +4060,16 @@ gethere(char **strp, int typ)
     return s;
 }
 
+/*
+ * Longest here-string passed through a pipe when MEMORY_TEMP_FILES
+ * is set; a pipe can always hold this much without a reader.
+ */
+#ifdef PIPE_BUF
+# define HERESTR_PIPE_MAX PIPE_BUF
+#else
+# define HERESTR_PIPE_MAX 512
+#endif
+
 /* open here string fd */
 
 /**/
@@ -3666,6 +4092,31 @@ getherestr(struct redir *fn)
      */
     if (!(fn->flags & REDIRF_FROM_HEREDOC))
 	t[len++] = '\n';
+    if (isset(MEMORYTEMPFILES)) {
+	/*
+	 * Avoid the file system altogether.  Anything that fits
+	 * in a pipe can be written before the reader starts
+	 * without blocking; otherwise use an anonymous file.
+	 */
+	if (len <= HERESTR_PIPE_MAX) {
+	    int pipes[2];
+
+	    if (pipe(pipes) == 0) {
+		if (write_loop(pipes[1], t, len) == len) {
+		    close(pipes[1]);
+		    return pipes[0];
+		}
+		close(pipes[0]);
+		close(pipes[1]);
+	    }
+	}
+	if ((fd = getmemtempfile("zsh-herestr")) >= 0) {
+	    if (write_loop(fd, t, len) == len &&
+		lseek(fd, 0, SEEK_SET) == 0)
+		return fd;
+	    close(fd);
+	}
+    }
     if ((fd = gettempfile(NULL, 1, &s)) < 0)
 	return -1;
     write_loop(fd, t, len);
@@ -3713,6 +4164,7 @@ getoutput(char *cmd, int qt)
     pid_t pid;
     char *s;
 
+    perfcounts[PC_CMDSUBST]++;
     if (!(prog = parse_string(cmd, 0)))
 	return NULL;
 
@@ -3770,6 +4222,45 @@ getoutput(char *cmd, int qt)
     return NULL;
 }
 
+/*
+ * Start a subshell running the command line cmd in the background,
+ * as for a task of the jobpool builtin.  If outfd is not NULL, the
+ * subshell's standard output is a pipe whose reading end is
+ * returned there.  Returns the process ID, or -1 on failure.
+ */
+
+/**/
+pid_t
+forkstring(char *cmd, int *outfd, char *context)
+{
+    int pipes[2];
+    pid_t pid;
+
+    if (outfd && mpipe(pipes) < 0)
+	return -1;
+    if ((pid = zfork(NULL))) {
+	if (outfd) {
+	    zclose(pipes[1]);
+	    if (pid == -1) {
+		zclose(pipes[0]);
+		*outfd = -1;
+	    } else
+		*outfd = pipes[0];
+	}
+	return pid;
+    }
+    /* pid == 0 */
+    child_unblock();
+    if (outfd) {
+	zclose(pipes[0]);
+	redup(pipes[1], 1);
+    }
+    entersubsh(ESUB_NOMONITOR);
+    execstring(cmd, 1, 1, context);
+    _exit(lastval);
+    return -1;
+}
+
 /* read output of command substitution */
 
 /**/
@@ -3864,15 +4355,32 @@ getoutputfile(char *cmd, char **eptr)
     pid_t pid;
     char *nam;
     Eprog prog;
-    int fd;
+    int fd, memfd = -1;
     char *s;
 
     if (thisjob == -1)
 	return NULL;
     if (!(prog = parsecmd(cmd, eptr)))
 	return NULL;
-    if (!(nam = gettempname(NULL, 0)))
-	return NULL;
+#ifdef PATH_DEV_FD
+    /*
+     * With MEMORY_TEMP_FILES, use an anonymous file and pass its
+     * name under PATH_DEV_FD, as for process substitution.  The
+     * descriptor is kept open in the shell until the job finishes.
+     */
+    if (isset(MEMORYTEMPFILES) &&
+	(fd = movefd(getmemtempfile("zsh-equalsubst"))) >= 0) {
+	nam = hcalloc(strlen(PATH_DEV_FD) + 6);
+	sprintf(nam, "%s/%d", PATH_DEV_FD, fd);
+	fdtable[fd] = FDT_PROC_SUBST;
+	addfilelist(NULL, fd);
+    } else
+#endif
+    {
+	if (!(nam = gettempname(NULL, 0)))
+	    return NULL;
+	fd = -1;
+    }
 
     if ((s = simple_redir_name(prog, REDIR_HERESTR))) {
 	/*
@@ -3887,18 +4395,25 @@ getoutputfile(char *cmd, char **eptr)
 	    untokenize(s);
     }
 
-    addfilelist(nam, 0);
+    if (fd < 0)
+	addfilelist(nam, 0);
 
     if (!s)
 	child_block();
-    fd = open(nam, O_WRONLY | O_CREAT | O_EXCL | O_NOCTTY, 0600);
+    if (fd < 0)
+	fd = open(nam, O_WRONLY | O_CREAT | O_EXCL | O_NOCTTY, 0600);
+    else
+	memfd = fd;
 
     if (s) {
 	/* optimised here-string */
 	int len;
 	unmetafy(s, &len);
 	write_loop(fd, s, len);
-	close(fd);
+	if (memfd >= 0)
+	    lseek(fd, 0, SEEK_SET);
+	else
+	    close(fd);
 	return nam;
     }
 
@@ -3909,11 +4424,15 @@ getoutputfile(char *cmd, char **eptr)
     } else if (pid) {
 	int os;
 
-	close(fd);
 	os = jobtab[thisjob].stat;
 	waitforpid(pid, 0);
 	cmdoutval = 0;
 	jobtab[thisjob].stat = os;
+	/* rewind in case PATH_DEV_FD shares the file offset */
+	if (memfd >= 0)
+	    lseek(fd, 0, SEEK_SET);
+	else
+	    close(fd);
 	return nam;
     }
 
@@ -4459,15 +4978,20 @@ execautofn(Estate state, UNUSED(int do_exec))
 Shfunc
 loadautofn(Shfunc shf, int fksh, int autol)
 {
-    int noalias = noaliases, ksh = 1;
+    int noalias = noaliases, ksh = 1, prof = -1;
     Eprog prog;
     char *fname;
 
+    perfcounts[PC_AUTOLOAD]++;
     pushheap();
 
+    if (startprofiling)
+	prof = startprofbegin(dyncat("autoload ", shf->node.nam));
     noaliases = (shf->node.flags & PM_UNALIASED);
     prog = getfpfunc(shf->node.nam, &ksh, &fname);
     noaliases = noalias;
+    if (prof >= 0)
+	startprofend(prof);
 
     if (ksh == 1) {
 	ksh = fksh;
@@ -4597,7 +5121,7 @@ doshfunc(Shfunc shfunc, LinkList doshargs, int noreturnval)
     char *name = shfunc->node.nam;
     int flags = shfunc->node.flags, ooflags;
     char *fname = dupstring(name);
-    int obreaks, saveemulation, restore_sticky;
+    int obreaks, saveemulation, restore_sticky, prof = -1;
     Eprog prog;
     struct funcstack fstack;
     static int oflags;
@@ -4608,6 +5132,10 @@ doshfunc(Shfunc shfunc, LinkList doshargs, int noreturnval)
 
     pushheap();
 
+    /* Profile functions called directly from startup files. */
+    if (startprofiling && (!funcstack || funcstack->tp == FS_SOURCE))
+	prof = startprofbegin(dyncat("function ", name));
+
     oargv0 = NULL;
     obreaks = breaks;;
     if (trap_state == TRAP_STATE_PRIMED)
@@ -4827,6 +5355,8 @@ doshfunc(Shfunc shfunc, LinkList doshargs, int noreturnval)
 	}
     }
 
+    if (prof >= 0)
+	startprofend(prof);
     return ret;
 }
 
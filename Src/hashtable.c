@@ -228,6 +228,7 @@ gethashnode(HashTable ht, const char *nam)
     unsigned hashval;
     HashNode hp;
 
+    perfcounts[PC_HASHLOOKUP]++;
     hashval = ht->hash(nam) % ht->hsize;
     for (hp = ht->nodes[hashval]; hp; hp = hp->next) {
 	if (ht->cmpnodes(hp->nam, nam) == 0) {
@@ -252,6 +253,7 @@ gethashnode2(HashTable ht, const char *nam)
     unsigned hashval;
     HashNode hp;
 
+    perfcounts[PC_HASHLOOKUP]++;
     hashval = ht->hash(nam) % ht->hsize;
     for (hp = ht->nodes[hashval]; hp; hp = hp->next) {
 	if (ht->cmpnodes(hp->nam, nam) == 0)
@@ -638,6 +640,7 @@ hashdir(char **dirp)
 
     if (isrelative(*dirp))
 	return;
+    perfcounts[PC_REHASH]++;
     unmetadir = unmeta(*dirp);
     if (!(dir = opendir(unmetadir)))
 	return;
@@ -1017,8 +1020,8 @@ createreswdtable(void)
     reswdtab->getnode     = gethashnode;
     reswdtab->getnode2    = gethashnode2;
     reswdtab->removenode  = NULL;
-    reswdtab->disablenode = disablehashnode;
-    reswdtab->enablenode  = enablehashnode;
+    reswdtab->disablenode = disablereswdnode;
+    reswdtab->enablenode  = enablereswdnode;
     reswdtab->freenode    = NULL;
     reswdtab->printnode   = printreswdnode;
 
@@ -1077,16 +1080,73 @@ createaliastable(HashTable ht)
     ht->emptytable  = NULL;
     ht->filltable   = NULL;
     ht->cmpnodes    = strcmp;
-    ht->addnode     = addhashnode;
+    ht->addnode     = addaliasnode;
     ht->getnode     = gethashnode;
     ht->getnode2    = gethashnode2;
-    ht->removenode  = removehashnode;
-    ht->disablenode = disablehashnode;
-    ht->enablenode  = enablehashnode;
+    ht->removenode  = removealiasnode;
+    ht->disablenode = disablealiasnode;
+    ht->enablenode  = enablealiasnode;
     ht->freenode    = freealiasnode;
     ht->printnode   = printaliasnode;
 }
 
+/*
+ * Count of changes to the alias tables and to the set of enabled
+ * reserved words.  Parsing depends on both, so the parse cache uses
+ * this to tell whether an entry is still good.
+ */
+
+/**/
+mod_export zlong aliasgen;
+
+/**/
+static void
+addaliasnode(HashTable ht, char *nam, void *nodeptr)
+{
+    aliasgen++;
+    addhashnode(ht, nam, nodeptr);
+}
+
+/**/
+static HashNode
+removealiasnode(HashTable ht, const char *nam)
+{
+    aliasgen++;
+    return removehashnode(ht, nam);
+}
+
+/**/
+static void
+disablealiasnode(HashNode hn, int flags)
+{
+    aliasgen++;
+    disablehashnode(hn, flags);
+}
+
+/**/
+static void
+enablealiasnode(HashNode hn, int flags)
+{
+    aliasgen++;
+    enablehashnode(hn, flags);
+}
+
+/**/
+static void
+disablereswdnode(HashNode hn, int flags)
+{
+    aliasgen++;
+    disablehashnode(hn, flags);
+}
+
+/**/
+static void
+enablereswdnode(HashNode hn, int flags)
+{
+    aliasgen++;
+    enablehashnode(hn, flags);
+}
+
 /**/
 void
 createaliastables(void)
@@ -89,11 +89,112 @@ mod_export int tccolours;
 /**/
 mod_export sigset_t sigchld_mask;
 
+/*
+ * The startup profile, recorded when ZSH_STARTUP_PROFILE is set to a
+ * non-empty value in the environment and reported on standard error
+ * once initialisation is complete.  There is an entry for each phase of
+ * initialisation, each file sourced, each module loaded, each function
+ * autoloaded and each function called from a startup file, in the order
+ * they started; the times include those of the entries nested within.
+ */
+
+struct startprof {
+    char *what;
+    int depth;
+    double wall;
+    double cpu;
+};
+
+static struct startprof *startprofs;
+static int nstartprofs, startprofsize, startprofdepth;
+static double startprofwall, startprofcpu0;
+
+/**/
+mod_export int startprofiling;
+
+/* Processor time used by the shell in seconds. */
+
+static double
+startprofcpu(void)
+{
+#ifdef HAVE_GETRUSAGE
+    struct rusage ru;
+
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_stime.tv_sec +
+	(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+#else
+    return (double) clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+/* Start an entry of the startup profile and return its number. */
+
+/**/
+mod_export int
+startprofbegin(char *what)
+{
+    struct startprof *sp;
+
+    if (nstartprofs == startprofsize) {
+	startprofsize = startprofsize ? 2 * startprofsize : 64;
+	startprofs = (struct startprof *)
+	    zrealloc(startprofs, startprofsize * sizeof(struct startprof));
+    }
+    sp = startprofs + nstartprofs;
+    sp->what = ztrdup(what);
+    sp->depth = startprofdepth++;
+    sp->wall = -zmonotime();
+    sp->cpu = -startprofcpu();
+    return nstartprofs++;
+}
+
+/* Finish the entry started with startprofbegin(). */
+
+/**/
+mod_export void
+startprofend(int n)
+{
+    if (n < 0 || n >= nstartprofs)
+	return;
+    startprofs[n].wall += zmonotime();
+    startprofs[n].cpu += startprofcpu();
+    startprofdepth--;
+}
+
+/* Print the startup profile and stop recording. */
+
+static void
+startprofreport(void)
+{
+    struct startprof *sp;
+
+    fprintf(stderr, "zsh startup profile (ms, including nested entries):\n"
+	    "%9s %9s\n", "wall", "cpu");
+    for (sp = startprofs; sp < startprofs + nstartprofs; sp++) {
+	fprintf(stderr, "%9.2f %9.2f  %*s", sp->wall * 1000.0,
+		sp->cpu * 1000.0, 2 * sp->depth, "");
+	zputs(sp->what, stderr);
+	fputc('\n', stderr);
+	zsfree(sp->what);
+    }
+    fprintf(stderr, "%9.2f %9.2f  total\n",
+	    (zmonotime() - startprofwall) * 1000.0,
+	    (startprofcpu() - startprofcpu0) * 1000.0);
+    fflush(stderr);
+    zfree(startprofs, startprofsize * sizeof(struct startprof));
+    startprofs = NULL;
+    nstartprofs = startprofsize = startprofdepth = 0;
+    startprofiling = 0;
+}
+
 /**/
 mod_export struct hookdef zshhooks[] = {
     HOOKDEF("exit", NULL, HOOKF_ALL),
     HOOKDEF("before_trap", NULL, HOOKF_ALL),
     HOOKDEF("after_trap", NULL, HOOKF_ALL),
+    HOOKDEF("before_exec", NULL, HOOKF_ALL),
+    HOOKDEF("after_exec", NULL, HOOKF_ALL),
 };
 
 /* keep executing lists until EOF found */
@@ -1091,6 +1192,8 @@ setupshin(char *runscript)
      * Finish setting up SHIN and its relatives.
      */
     bshin = SHIN ? fdopen(SHIN, "r") : stdin;
+    if (SHIN)
+	shinbufpush();
     if (isset(SHINSTDIN) && !SHIN && unset(INTERACTIVE)) {
 #ifdef _IONBF
 	setvbuf(stdin, NULL, _IONBF, 0);
@@ -1228,8 +1331,10 @@ init_misc(void)
 #endif
 	dosetopt(RESTRICTED, 1, 0, opts);
     if (cmd) {
-	if (SHIN >= 10)
+	if (SHIN >= 10) {
+	    shinbufpop();
 	    fclose(bshin);
+	}
 	SHIN = movefd(open("/dev/null", O_RDONLY | O_NOCTTY));
 	bshin = fdopen(SHIN, "r");
 	execstring(cmd, 0, 1, "cmdarg");
@@ -1241,6 +1346,36 @@ init_misc(void)
 	readhistfile(NULL, 0, HFILE_USE_OPTIONS);
 }
 
+/*
+ * The names of the files sourced by the shell, each recorded once in
+ * the order they were first sourced, made absolute and with symbolic
+ * links resolved, for the sourcedfiles parameter of zsh/parameter.
+ */
+
+/**/
+mod_export LinkList sourcedfiles;
+
+/**/
+static void
+addsourcedfile(char *s)
+{
+    LinkNode n;
+    char *name;
+
+    if (*s != '/' && pwd)
+	s = zhtricat(pwd, "/", s);
+    if (!(name = xsymlink(s)))
+	name = ztrdup(s);
+    if (!sourcedfiles)
+	sourcedfiles = znewlinklist();
+    for (n = firstnode(sourcedfiles); n; incnode(n))
+	if (!strcmp((char *) getdata(n), name)) {
+	    zsfree(name);
+	    return;
+	}
+    zaddlinknode(sourcedfiles, name);
+}
+
 /*
  * source a file
  * Returns one of the SOURCE_* enum values.
@@ -1261,13 +1396,22 @@ source(char *s)
     int ocsp;
     int otrap_return = trap_return, otrap_state = trap_state;
     struct funcstack fstack;
+    struct sourcecache_state scs;
     enum source_return ret = SOURCE_OK;
+    int prof = -1;
 
     if (!s || 
 	(!(prog = try_source_file((us = unmeta(s)))) &&
+	 !(isset(SOURCECACHE) && (prog = sourcecache_get(us))) &&
 	 (tempfd = movefd(open(us, O_RDONLY | O_NOCTTY))) == -1)) {
 	return SOURCE_NOT_FOUND;
     }
+    addsourcedfile(s);
+    if (!prog && isset(SOURCECACHE)) {
+	us = dupstring(us);
+	sourcecache_start(tempfd, &scs);
+    } else
+	scs.ok = 0;
 
     /* save the current shell state */
     fd        = SHIN;            /* store the shell input fd                  */
@@ -1285,6 +1429,7 @@ source(char *s)
     if (!prog) {
 	SHIN = tempfd;
 	bshin = fdopen(SHIN, "r");
+	shinbufpush();
     }
     subsh  = 0;
     lineno = 1;
@@ -1306,6 +1451,8 @@ source(char *s)
     trap_state = TRAP_STATE_INACTIVE;
 
     sourcelevel++;
+    if (startprofiling)
+	prof = startprofbegin(dyncat("source ", s));
 
     fstack.name = scriptfilename;
     fstack.caller = funcstack ? funcstack->name :
@@ -1341,8 +1488,12 @@ source(char *s)
 	    ret = SOURCE_ERROR;
 	    break;
 	}
+	if (ret == SOURCE_OK && scs.ok)
+	    sourcecache_put(us, &scs);
     }
     funcstack = funcstack->prev;
+    if (prof >= 0)
+	startprofend(prof);
     sourcelevel--;
 
     trap_state = otrap_state;
@@ -1352,6 +1503,7 @@ source(char *s)
     if (prog)
 	freeeprog(prog);
     else {
+	shinbufpop();
 	fclose(bshin);
 	fdtable[SHIN] = FDT_UNUSED;
 	SHIN = fd;		     /* the shell input fd                   */
@@ -1555,8 +1707,15 @@ mod_export int use_exit_printed;
 mod_export int
 zsh_main(UNUSED(int argc), char **argv)
 {
-    char **t, *runscript = NULL;
-    int t0;
+    char **t, *runscript = NULL, *s;
+    int t0, prof = -1;
+
+    if ((s = getenv("ZSH_STARTUP_PROFILE")) && *s) {
+	startprofiling = 1;
+	startprofwall = zmonotime();
+	startprofcpu0 = startprofcpu();
+	prof = startprofbegin("arguments");
+    }
 #ifdef USE_LOCALE
     setlocale(LC_ALL, "");
 #endif
@@ -1607,15 +1766,39 @@ zsh_main(UNUSED(int argc), char **argv)
     /* sets INTERACTIVE, SHINSTDIN and SINGLECOMMAND */
     parseargs(argv, &runscript);
 
+    if (startprofiling) {
+	startprofend(prof);
+	prof = startprofbegin("terminal");
+    }
     SHTTY = -1;
     init_io();
+    if (startprofiling) {
+	startprofend(prof);
+	prof = startprofbegin("parameters and environment");
+    }
     setupvals();
 
+    if (startprofiling) {
+	startprofend(prof);
+	prof = startprofbegin("builtins and modules");
+    }
     init_signals();
     init_bltinmods();
     init_builtins();
+    if (startprofiling) {
+	startprofend(prof);
+	prof = startprofbegin("startup files");
+    }
     run_init_scripts();
+    if (startprofiling) {
+	startprofend(prof);
+	prof = startprofbegin("input");
+    }
     setupshin(runscript);
+    if (startprofiling) {
+	startprofend(prof);
+	startprofreport();
+    }
     init_misc();
 
     for (;;) {
@@ -84,6 +84,23 @@ int SHIN;
 /**/
 FILE *bshin;
 
+/*
+ * Block buffer for a script read by shingetline() when the shell has
+ * the input to itself, i.e. a script file or a file being sourced.
+ * This avoids going through stdio a character at a time.  Buffers
+ * are stacked as source() nests.
+ */
+
+struct shinbuf {
+    struct shinbuf *prev;
+    char *buf;
+    int pos, len;
+};
+
+#define SHINBUFSIZE	65536
+
+static struct shinbuf *shinbuf;
+
 /* != 0 means we are reading input from a string */
  
 /**/
@@ -99,11 +116,18 @@ mod_export int inbufct;
 /**/
 int inbufflags;
 
+/* Pointer into input buffer */
+
+/**/
+char *inbufptr;
+
+/* Characters left in current input stack element */
+
+/**/
+int inbufleft;
+
 static char *inbuf;		/* Current input buffer */
-static char *inbufptr;		/* Pointer into input buffer */
 static char *inbufpush;		/* Character at which to re-push alias */
-static int inbufleft;		/* Characters left in current input
-				   stack element */
 
 
  /* Input must be stacked since the input queue is used by
@@ -128,6 +152,86 @@ static struct instacks *instack, *instacktop;
 
 static int instacksz = INSTACK_INITIAL;
 
+/* Start block buffering input from SHIN. */
+
+/**/
+void
+shinbufpush(void)
+{
+    struct shinbuf *sb = (struct shinbuf *)zshcalloc(sizeof(*sb));
+
+    sb->prev = shinbuf;
+    shinbuf = sb;
+}
+
+/* Finish with the block buffer for SHIN, returning to the previous one. */
+
+/**/
+void
+shinbufpop(void)
+{
+    struct shinbuf *sb = shinbuf;
+
+    if (!sb)
+	return;
+    shinbuf = sb->prev;
+    if (sb->buf)
+	zfree(sb->buf, SHINBUFSIZE);
+    zfree(sb, sizeof(*sb));
+}
+
+/*
+ * Read a line from SHIN via shinbuf, metafying a chunk at a time.
+ * SIGWINCH is only let through while we wait in read().
+ */
+
+/**/
+static char *
+shinbufgetline(void)
+{
+    struct shinbuf *sb = shinbuf;
+    char *line = NULL, *start, *end, *nl, *p, *q;
+    int ll = 0, n, nmeta;
+
+    if (!sb->buf)
+	sb->buf = (char *)zalloc(SHINBUFSIZE);
+    for (;;) {
+	if (sb->pos == sb->len) {
+	    winch_unblock();
+	    do {
+		n = read(SHIN, sb->buf, SHINBUFSIZE);
+	    } while (n < 0 && errno == EINTR);
+	    winch_block();
+	    if (n <= 0)
+		return line;
+	    sb->pos = 0;
+	    sb->len = n;
+	}
+	start = sb->buf + sb->pos;
+	nl = (char *)memchr(start, '\n', sb->len - sb->pos);
+	end = nl ? nl + 1 : sb->buf + sb->len;
+	for (nmeta = 0, p = start; p < end; p++)
+	    if (imeta(*p))
+		nmeta++;
+	line = zrealloc(line, ll + (end - start) + nmeta + 1);
+	if (nmeta) {
+	    for (p = start, q = line + ll; p < end; p++) {
+		if (imeta(*p)) {
+		    *q++ = Meta;
+		    *q++ = *p ^ 32;
+		} else
+		    *q++ = *p;
+	    }
+	} else
+	    memcpy(line + ll, start, end - start);
+	ll += (end - start) + nmeta;
+	line[ll] = '\0';
+	sb->pos = end - sb->buf;
+	if (nl)
+	    return line;
+    }
+}
+
 /* Read a line from bshin.  Convert tokens and   *
  * null characters to Meta c^32 character pairs. */
 
@@ -141,6 +245,8 @@ shingetline(void)
     char buf[BUFSIZ];
     char *p;
 
+    if (shinbuf)
+	return shinbufgetline();
     p = buf;
     winch_unblock();
     for (;;) {
@@ -30,6 +30,10 @@
 #include "zsh.mdh"
 #include "jobs.pro"
 
+#ifdef HAVE_POLL_H
+# include <poll.h>
+#endif
+
 /* the process group of the shell at startup (equal to mypgprp, except
    when we started without being process group leader */
 
@@ -77,6 +81,24 @@ static struct job *oldjobtab;
 /* The size of that. */
 static int oldmaxjob;
 
+/*
+ * Lowest job table slot that may be free: all slots below it are
+ * in use, so initjob() need not look at them.
+ */
+static int freejobhint = 1;
+
+/*
+ * Index from process ID to the processes in the job table, chained
+ * through the pidnext field.  The size is always a power of two.
+ */
+static Process *pidindex;
+
+/* Number of buckets in pidindex, and number of processes in it. */
+static int pidindexsize, pidindexcount;
+
+#define PIDINDEX_INITSIZE	64
+#define pidindexslot(pid)	((unsigned)(pid) & (pidindexsize - 1))
+
 /* shell timings */
  
 /**/
@@ -150,6 +172,74 @@ makerunning(Job jn)
 	makerunning(jobtab + jn->other);
 }
 
+/* Add a process to the pid index. */
+
+static void
+pidindex_add(Process pn)
+{
+    Process *slot;
+
+    if (pidindexcount >= 2 * pidindexsize) {
+	/*
+	 * Grow the index.  The chains are rethreaded in place, so
+	 * keep the SIGCHLD handler out while we do it.
+	 */
+	int newsize = pidindexsize ? 2 * pidindexsize : PIDINDEX_INITSIZE;
+	Process *newindex = (Process *)zshcalloc(newsize * sizeof(Process));
+	Process *oldindex = pidindex, p, nx;
+	int oldsize = pidindexsize, i;
+	sigset_t oset = child_block();
+
+	pidindex = newindex;
+	pidindexsize = newsize;
+	for (i = 0; i < oldsize; i++) {
+	    for (p = oldindex[i]; p; p = nx) {
+		nx = p->pidnext;
+		slot = pidindex + pidindexslot(p->pid);
+		p->pidnext = *slot;
+		*slot = p;
+	    }
+	}
+	signal_setmask(oset);
+	if (oldindex)
+	    zfree(oldindex, oldsize * sizeof(Process));
+    }
+    slot = pidindex + pidindexslot(pn->pid);
+    pn->pidnext = *slot;
+    *slot = pn;
+    pidindexcount++;
+}
+
+/* Remove a process from the pid index. */
+
+static void
+pidindex_remove(Process pn)
+{
+    Process *slot;
+
+    if (!pidindexsize)
+	return;
+    for (slot = pidindex + pidindexslot(pn->pid); *slot;
+	 slot = &(*slot)->pidnext) {
+	if (*slot == pn) {
+	    *slot = pn->pidnext;
+	    pn->pidnext = NULL;
+	    pidindexcount--;
+	    return;
+	}
+    }
+}
+
+/* Forget everything in the pid index, e.g. when the job table is reset. */
+
+static void
+pidindex_clear(void)
+{
+    if (pidindexsize)
+	memset(pidindex, 0, pidindexsize * sizeof(Process));
+    pidindexcount = 0;
+}
+
 /* Find process and job associated with pid.         *
  * Return 1 if search was successful, else return 0. */
 
@@ -158,11 +248,12 @@ int
 findproc(pid_t pid, Job *jptr, Process *pptr, int aux)
 {
     Process pn;
-    int i;
 
     *jptr = NULL;
     *pptr = NULL;
-    for (i = 1; i <= maxjob; i++)
+    if (!pidindexsize)
+	return 0;
+    for (pn = pidindex[pidindexslot(pid)]; pn; pn = pn->pidnext)
     {
 	/*
 	 * We are only interested in jobs with processes still
@@ -170,33 +261,33 @@ findproc(pid_t pid, Job *jptr, Process *pptr, int aux)
 	 * process number in a job we haven't quite got around
 	 * to deleting.
 	 */
-	if (jobtab[i].stat & STAT_DONE)
+	if (pn->pid != pid || !pn->aux != !aux ||
+	    (jobtab[pn->job].stat & STAT_DONE))
 	    continue;
 
-	for (pn = aux ? jobtab[i].auxprocs : jobtab[i].procs;
-	     pn; pn = pn->next)
-	{
-	    /*
-	     * Make sure we match a process that's still running.
-	     *
-	     * When a job contains two pids, one terminated pid and one
-	     * running pid, then the condition (jobtab[i].stat &
-	     * STAT_DONE) will not stop these pids from being candidates
-	     * for the findproc result (which is supposed to be a
-	     * RUNNING pid), and if the terminated pid is an identical
-	     * process number for the pid identifying the running
-	     * process we are trying to find (after pid number
-	     * wrapping), then we need to avoid returning the terminated
-	     * pid, otherwise the shell would block and wait forever for
-	     * the termination of the process which pid we were supposed
-	     * to return in a different job.
-	     */
-	    if (pn->pid == pid) {
-		*pptr = pn;
-		*jptr = jobtab + i;
-		if (pn->status == SP_RUNNING) 
-		    return 1;
-	    }
+	/*
+	 * Make sure we match a process that's still running.
+	 *
+	 * When a job contains two pids, one terminated pid and one
+	 * running pid, then the condition (jobtab[i].stat &
+	 * STAT_DONE) will not stop these pids from being candidates
+	 * for the findproc result (which is supposed to be a
+	 * RUNNING pid), and if the terminated pid is an identical
+	 * process number for the pid identifying the running
+	 * process we are trying to find (after pid number
+	 * wrapping), then we need to avoid returning the terminated
+	 * pid, otherwise the shell would block and wait forever for
+	 * the termination of the process which pid we were supposed
+	 * to return in a different job.
+	 */
+	if (pn->status == SP_RUNNING) {
+	    *pptr = pn;
+	    *jptr = jobtab + pn->job;
+	    return 1;
+	}
+	if (!*pptr) {
+	    *pptr = pn;
+	    *jptr = jobtab + pn->job;
 	}
     }
 
@@ -738,6 +829,30 @@ printtime(struct timeval *real, child_times_t *ti, char *desc)
 		    break;
 		}
 		break;
+	    case 'm':
+	    case 'u':
+		{
+		    /* milliseconds or microseconds */
+		    double scale = (*s == 'm') ? 1e3 : 1e6;
+		    char *unit = (*s == 'm') ? "ms" : "us";
+
+		    switch (*++s) {
+		    case 'E':
+			fprintf(stderr, "%0.f%s", elapsed_time * scale, unit);
+			break;
+		    case 'U':
+			fprintf(stderr, "%0.f%s", user_time * scale, unit);
+			break;
+		    case 'S':
+			fprintf(stderr, "%0.f%s", system_time * scale, unit);
+			break;
+		    default:
+			fprintf(stderr, "%%%c", s[-1]);
+			s--;
+			break;
+		    }
+		}
+		break;
 	    case 'P':
 		fprintf(stderr, "%d%%", percent);
 		break;
@@ -874,8 +989,10 @@ dumptime(Job jn)
 
 /* Check whether shell should report the amount of time consumed   *
  * by job.  This will be the case if we have preceded the command  *
- * with the keyword time, or if REPORTTIME is non-negative and the *
- * amount of time consumed by the job is greater than REPORTTIME   */
+ * with the keyword time, if REPORTTIME is non-negative and the    *
+ * amount of time consumed by the job is greater than REPORTTIME,  *
+ * or if REPORTMEMORY is non-negative and a process of the job had *
+ * a maximum resident set size greater than REPORTMEMORY kilobytes */
 
 /**/
 static int
@@ -884,7 +1001,7 @@ should_report_time(Job j)
     struct value vbuf;
     Value v;
     char *s = "REPORTTIME";
-    zlong reporttime;
+    zlong reporttime, reportmemory = -1;
 
     /* if the time keyword was used */
     if (j->stat & STAT_TIMED)
@@ -892,17 +1009,36 @@ should_report_time(Job j)
 
     queue_signals();
     if (!(v = getvalue(&vbuf, &s, 0)) ||
-	(reporttime = getintvalue(v)) < 0) {
-	unqueue_signals();
-	return 0;
-    }
+	(reporttime = getintvalue(v)) < 0)
+	reporttime = -1;
+#if defined(HAVE_GETRUSAGE) && defined(HAVE_STRUCT_RUSAGE_RU_MAXRSS)
+    s = "REPORTMEMORY";
+    if (!(v = getvalue(&vbuf, &s, 0)) ||
+	(reportmemory = getintvalue(v)) < 0)
+	reportmemory = -1;
+#endif
     unqueue_signals();
+    if (reporttime < 0 && reportmemory < 0)
+	return 0;
     /* can this ever happen? */
     if (!j->procs)
 	return 0;
     if (zleactive)
 	return 0;
 
+#if defined(HAVE_GETRUSAGE) && defined(HAVE_STRUCT_RUSAGE_RU_MAXRSS)
+    if (reportmemory >= 0) {
+	Process pn;
+
+	/* any process of the job will do, e.g. one stage of a pipeline */
+	for (pn = j->procs; pn; pn = pn->next)
+	    if (pn->ti.ru_maxrss > reportmemory)
+		return 1;
+    }
+#endif
+    if (reporttime < 0)
+	return 0;
+
 #ifdef HAVE_GETRUSAGE
     reporttime -= j->procs->ti.ru_utime.tv_sec + j->procs->ti.ru_stime.tv_sec;
     if (j->procs->ti.ru_utime.tv_usec +
@@ -1230,6 +1366,7 @@ freejob(Job jn, int deleting)
     jn->procs = NULL;
     for (; pn; pn = nx) {
 	nx = pn->next;
+	pidindex_remove(pn);
 	zfree(pn, sizeof(struct process));
     }
 
@@ -1237,6 +1374,7 @@ freejob(Job jn, int deleting)
     jn->auxprocs = NULL;
     for (; pn; pn = nx) {
 	nx = pn->next;
+	pidindex_remove(pn);
 	zfree(pn, sizeof(struct process));
     }
 
@@ -1258,6 +1396,8 @@ freejob(Job jn, int deleting)
     jn->stat = jn->stty_in_env = 0;
     jn->filelist = NULL;
     jn->ty = NULL;
+    if (jn > jobtab && jn - jobtab < freejobhint)
+	freejobhint = jn - jobtab;
 
     /* Find the new highest job number. */
     if (maxjob == jn - jobtab) {
@@ -1319,6 +1459,8 @@ addproc(pid_t pid, char *text, int aux, struct timeval *bgtime)
 	*pn->text = '\0';
     pn->status = SP_RUNNING;
     pn->next = NULL;
+    pn->job = thisjob;
+    pn->aux = aux;
 
     if (!aux)
     {
@@ -1342,6 +1484,7 @@ addproc(pid_t pid, char *text, int aux, struct timeval *bgtime)
 	/* first process for this job */
 	*pnlist = pn;
     }
+    pidindex_add(pn);
     /* If the first process in the job finished before any others were *
      * added, maybe STAT_DONE got set incorrectly.  This can happen if *
      * a $(...) was waited for and the last existing job in the        *
@@ -1392,7 +1535,8 @@ waitforpid(pid_t pid, int wait_cmd)
 	    kill(pid, SIGCONT);
 
 	last_signal = -1;
-	signal_suspend(SIGCHLD, wait_cmd);
+	if (!signal_suspend_pids(&pid, 1, wait_cmd))
+	    signal_suspend(SIGCHLD, wait_cmd);
 	if (last_signal != SIGCHLD && wait_cmd && last_signal >= 0 &&
 	    (sigtrapped[last_signal] & ZSIG_TRAPPED)) {
 	    /* wait command interrupted, but no error: return */
@@ -1408,6 +1552,32 @@ waitforpid(pid_t pid, int wait_cmd)
     return 0;
 }
 
+/*
+ * Suspend until something happens to a job we're waiting for.
+ * Where possible only wake up when one of the job's own processes
+ * exits, not for every other child.  A subshell needs to see its
+ * jobs stop so it can restart them, and a super-job needs the state
+ * of its sub-job, so those always use signal_suspend().
+ */
+
+static void
+job_suspend(Job jn, int wait_cmd)
+{
+    pid_t pids[MAX_SUSPEND_PIDS];
+    int npids = 0, aux;
+    Process pn;
+
+    if (!subsh && !(jn->stat & STAT_SUPERJOB)) {
+	for (aux = 0; aux < 2; aux++)
+	    for (pn = aux ? jn->auxprocs : jn->procs;
+		 pn && npids < MAX_SUSPEND_PIDS; pn = pn->next)
+		if (pn->status == SP_RUNNING)
+		    pids[npids++] = pn->pid;
+    }
+    if (!signal_suspend_pids(pids, npids, wait_cmd))
+	signal_suspend(SIGCHLD, wait_cmd);
+}
+
 /*
  * Wait for a job to finish.
  * wait_cmd indicates this is from the wait builtin; see
@@ -1444,7 +1614,7 @@ zwaitjob(int job, int wait_cmd)
 	while (!errflag && jn->stat &&
 	       !(jn->stat & STAT_DONE) &&
 	       !(interact && (jn->stat & STAT_STOPPED))) {
-	    signal_suspend(SIGCHLD, wait_cmd);
+	    job_suspend(jn, wait_cmd);
 	    if (last_signal != SIGCHLD && wait_cmd && last_signal >= 0 &&
 		(sigtrapped[last_signal] & ZSIG_TRAPPED))
 	    {
@@ -1535,6 +1705,9 @@ clearjobtab(int monitor)
 
     memset(jobtab, 0, jobtabsize * sizeof(struct job)); /* zero out table */
     maxjob = 0;
+    freejobhint = 1;
+    /* any processes left are now only in the saved table */
+    pidindex_clear();
 
     /*
      * Although we don't have job control in subshells, we
@@ -1549,6 +1722,7 @@ clearjobtab(int monitor)
 static int initnewjob(int i)
 {
     jobtab[i].stat = STAT_INUSE;
+    freejobhint = i + 1;
     if (jobtab[i].pwd) {
 	zsfree(jobtab[i].pwd);
 	jobtab[i].pwd = NULL;
@@ -1569,7 +1743,7 @@ initjob(void)
 {
     int i;
 
-    for (i = 1; i <= maxjob; i++)
+    for (i = freejobhint; i <= maxjob; i++)
 	if (!jobtab[i].stat)
 	    return initnewjob(i);
     if (maxjob + 1 < jobtabsize)
@@ -2591,6 +2765,292 @@ bin_suspend(char *name, UNUSED(char **argv), Options ops, UNUSED(int func))
     return 0;
 }
 
+/*
+ * State for one task run by jobpool: the process running it and,
+ * if its output is being captured, the pipe it writes to and
+ * what has been read from that so far.
+ */
+
+struct pooltask {
+    pid_t pid;
+    Process pn;
+    int status;
+    int fd;
+    char *buf;
+    int len, size;
+};
+
+/*
+ * Start a task of a jobpool, running the command line cmd as a
+ * subshell added to job pooljob.  Returns 0 if it couldn't be
+ * started.
+ */
+
+static int
+jobpool_start(struct pooltask *task, int pooljob, char *cmd, int capture)
+{
+    int ojob;
+    Job jn;
+    pid_t pid;
+
+    if ((pid = forkstring(cmd, capture ? &task->fd : NULL, "jobpool")) == -1)
+	return 0;
+    ojob = thisjob;
+    thisjob = pooljob;
+    addproc(pid, NULL, 1, NULL);
+    thisjob = ojob;
+    findproc(pid, &jn, &task->pn, 1);
+    task->pid = pid;
+    if (capture) {
+	task->size = 256;
+	task->buf = (char *)zalloc(task->size);
+    } else
+	task->fd = -1;
+    task->len = 0;
+    return 1;
+}
+
+/*
+ * Read what's available from the output of a task.  Closes the
+ * pipe on end of file.
+ */
+
+static void
+jobpool_read(struct pooltask *task)
+{
+    int cnt;
+
+    if (task->len == task->size) {
+	task->buf = (char *)zrealloc(task->buf, 2 * task->size);
+	task->size *= 2;
+    }
+    cnt = read(task->fd, task->buf + task->len, task->size - task->len);
+    if (cnt > 0)
+	task->len += cnt;
+    else if (cnt == 0 || errno != EINTR) {
+	zclose(task->fd);
+	task->fd = -1;
+    }
+}
+
+/*
+ * jobpool [ -j max ] [ -n num ] [ -a status ] [ -o output ] \
+ *         command [ arg ... ] -- item ...
+ *
+ * Run command once for each group of num items, with at most max
+ * copies running at once.
+ */
+
+/**/
+int
+bin_jobpool(char *name, char **argv, Options ops, UNUSED(int func))
+{
+    char **cmdargs, **items, **ap, *cmd, *statname, *outname;
+    struct pooltask *tasks;
+    int maxrun, peritem, nitems, ntasks, next, nrunning, i, ret = 0;
+    int pooljob, *running, q;
+    char **statarr, **outarr;
+
+    if (OPT_ISSET(ops,'j')) {
+	if ((maxrun = (int)zstrtol(OPT_ARG(ops,'j'), NULL, 10)) < 1) {
+	    zwarnnam(name, "invalid number of jobs: %s", OPT_ARG(ops,'j'));
+	    return 1;
+	}
+    } else {
+#if defined(HAVE_SYSCONF) && defined(_SC_NPROCESSORS_ONLN)
+	if ((maxrun = (int)sysconf(_SC_NPROCESSORS_ONLN)) < 1)
+#endif
+	    maxrun = 1;
+    }
+    if (OPT_ISSET(ops,'n')) {
+	if ((peritem = (int)zstrtol(OPT_ARG(ops,'n'), NULL, 10)) < 1) {
+	    zwarnnam(name, "invalid number of items: %s", OPT_ARG(ops,'n'));
+	    return 1;
+	}
+    } else
+	peritem = 1;
+    statname = OPT_ISSET(ops,'a') ? OPT_ARG(ops,'a') : NULL;
+    outname = OPT_ISSET(ops,'o') ? OPT_ARG(ops,'o') : NULL;
+
+    cmdargs = argv;
+    for (ap = argv; *ap && strcmp(*ap, "--"); ap++)
+	;
+    if (!*ap) {
+	zwarnnam(name, "missing `--' before items");
+	return 1;
+    }
+    if (ap == cmdargs) {
+	zwarnnam(name, "no command given");
+	return 1;
+    }
+    *ap = NULL;
+    items = ap + 1;
+    nitems = arrlen(items);
+    ntasks = (nitems + peritem - 1) / peritem;
+
+    /* Quote the command once; items are added for each task. */
+    cmd = "";
+    for (ap = cmdargs; *ap; ap++)
+	cmd = zhtricat(cmd, quotestring(*ap, NULL, QT_SINGLE_OPTIONAL), " ");
+
+    if (!ntasks) {
+	if (statname)
+	    setaparam(statname, mkarray(NULL));
+	if (outname)
+	    setaparam(outname, mkarray(NULL));
+	return 0;
+    }
+    if ((pooljob = initjob()) == -1)
+	return 1;
+    jobtab[pooljob].stat |= STAT_NOPRINT;
+
+    tasks = (struct pooltask *)zhalloc(ntasks * sizeof(struct pooltask));
+    running = (int *)zhalloc(maxrun * sizeof(int));
+    statarr = (char **)zshcalloc((ntasks + 1) * sizeof(char *));
+    outarr = (char **)zshcalloc((ntasks + 1) * sizeof(char *));
+    for (i = 0; i < ntasks; i++) {
+	tasks[i].pn = NULL;
+	tasks[i].fd = -1;
+	tasks[i].buf = NULL;
+	tasks[i].len = 0;
+    }
+
+    q = queue_signal_level();
+    dont_queue_signals();
+    child_block();
+    next = nrunning = 0;
+    for (;;) {
+	int r, closing = 0;
+
+	/* Collect tasks that have finished and whose output is all read. */
+	for (r = 0; r < nrunning; ) {
+	    struct pooltask *task = tasks + running[r];
+	    int status = task->pn->status;
+
+	    if (status == SP_RUNNING || WIFSTOPPED(status)
+#ifdef WIFCONTINUED
+		|| WIFCONTINUED(status)
+#endif
+		|| task->fd >= 0) {
+		if (task->fd < 0)
+		    closing = 1;
+		r++;
+		continue;
+	    }
+	    task->status = WIFSIGNALED(status) ?
+		0200 | WTERMSIG(status) : WEXITSTATUS(status);
+	    if (task->status)
+		ret = 1;
+	    running[r] = running[--nrunning];
+	}
+
+	/* Keep the pool full unless we've been interrupted. */
+	while (nrunning < maxrun && next < ntasks && !errflag) {
+	    char *line = cmd;
+	    int end = next * peritem + peritem;
+
+	    if (end > nitems)
+		end = nitems;
+	    for (i = next * peritem; i < end; i++)
+		line = zhtricat(line, quotestring(items[i], NULL,
+						  QT_SINGLE_OPTIONAL), " ");
+	    if (!jobpool_start(tasks + next, pooljob, line, !!outname)) {
+		zwarnnam(name, "can't start job: %e", errno);
+		errflag = 1;
+		break;
+	    }
+	    running[nrunning++] = next++;
+	}
+	if (!nrunning)
+	    break;
+
+	if (outname) {
+#ifdef HAVE_POLL
+	    struct pollfd *fds;
+	    int nfds = 0;
+
+	    fds = (struct pollfd *)zhalloc(nrunning * sizeof(struct pollfd));
+	    for (r = 0; r < nrunning; r++) {
+		if (tasks[running[r]].fd >= 0) {
+		    fds[nfds].fd = tasks[running[r]].fd;
+		    fds[nfds].events = POLLIN;
+		    nfds++;
+		}
+	    }
+	    if (nfds) {
+		/*
+		 * A task whose output is finished may exit while
+		 * we're in poll(); don't wait long for it.
+		 */
+		child_unblock();
+		nfds = poll(fds, nfds, closing ? 10 : -1);
+		child_block();
+		for (r = 0; r < nrunning; r++) {
+		    struct pooltask *task = tasks + running[r];
+		    for (i = 0; i < nfds && task->fd >= 0; i++) {
+			if (fds[i].fd == task->fd) {
+			    if (fds[i].revents)
+				jobpool_read(task);
+			    break;
+			}
+		    }
+		}
+		continue;
+	    }
+#else
+	    /* Without poll(), just read each output in turn. */
+	    for (r = 0; r < nrunning; r++)
+		while (tasks[running[r]].fd >= 0)
+		    jobpool_read(tasks + running[r]);
+#endif
+	}
+	{
+	    pid_t pids[MAX_SUSPEND_PIDS];
+	    int npids;
+
+	    for (npids = 0; npids < nrunning && npids < MAX_SUSPEND_PIDS;
+		 npids++)
+		pids[npids] = tasks[running[npids]].pid;
+	    if (!signal_suspend_pids(pids, npids, 0))
+		signal_suspend(SIGCHLD, 0);
+	    child_block();
+	}
+    }
+    child_unblock();
+    restore_queue_signals(q);
+
+    for (i = 0; i < ntasks; i++) {
+	struct pooltask *task = tasks + i;
+	char buf[DIGBUFSIZE];
+
+	if (i < next) {
+	    sprintf(buf, "%d", task->status);
+	    statarr[i] = ztrdup(buf);
+	} else {
+	    /* never started */
+	    statarr[i] = ztrdup("");
+	    ret = 1;
+	}
+	while (task->len && task->buf[task->len - 1] == '\n')
+	    task->len--;
+	outarr[i] = metafy(task->buf ? task->buf : "", task->len, META_DUP);
+	if (task->buf)
+	    zfree(task->buf, task->size);
+    }
+    deletejob(jobtab + pooljob, 0);
+
+    if (statname)
+	setaparam(statname, statarr);
+    else
+	freearray(statarr);
+    if (outname)
+	setaparam(outname, outarr);
+    else
+	freearray(outarr);
+
+    return ret || errflag;
+}
+
 /* find a job named s */
 
 /**/
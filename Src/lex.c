@@ -185,6 +185,19 @@ mod_export char *tokstrings[WHILE + 1] = {
     ";|",	/* SEMIBAR	     */
 };
 
+/*
+ * Get the next character for the lexer.  With history off, as for
+ * scripts, eval and sourced files, hgetc is plain ingetc(), so an
+ * ordinary character can be taken straight from the input buffer;
+ * ingetc() is only needed at the end of the buffer, for tokens
+ * that are skipped and for newlines, which count lines.
+ */
+
+#define lexgetc() \
+    ((hgetc == ingetc && inbufleft > 0 && !lexstop && \
+      *inbufptr != '\n' && !itok(STOUC(*inbufptr))) ? \
+     (inbufleft--, inbufct--, STOUC(*inbufptr++)) : hgetc())
+
 /* lexical state */
 
 static int dbparens;
@@ -615,7 +628,7 @@ cmd_or_math(int cs_type)
     *bptr = '\0';
     if (!c) {
 	/* Successfully parsed, see if it was math */
-	c = hgetc();
+	c = lexgetc();
 	if (c == ')')
 	    return 1; /* yes */
 	hungetc(c);
@@ -644,7 +657,7 @@ cmd_or_math(int cs_type)
 static int
 cmd_or_math_sub(void)
 {
-    int c = hgetc(), ret;
+    int c = lexgetc(), ret;
 
     if (c == '(') {
 	add(Inpar);
@@ -677,7 +690,7 @@ isnumglob(void)
     char *tbuf = (char *)zalloc(tbs);
 
     while(1) {
-	c = hgetc();
+	c = lexgetc();
 	if(lexstop) {
 	    lexstop = 0;
 	    break;
@@ -711,7 +724,7 @@ gettok(void)
 
   beginning:
     tokstr = NULL;
-    while (iblank(c = hgetc()) && !lexstop);
+    while (iblank(c = lexgetc()) && !lexstop);
     toklineno = lineno;
     if (lexstop)
 	return (errflag) ? LEXERR : ENDINPUT;
@@ -731,16 +744,16 @@ gettok(void)
 	    infor--;
 	    return DINPAR;
 	}
-	if (c || (c = hgetc()) != ')') {
+	if (c || (c = lexgetc()) != ')') {
 	    hungetc(c);
 	    return LEXERR;
 	}
 	dbparens = 0;
 	return DOUTPAR;
     } else if (idigit(c)) {	/* handle 1< foo */
-	d = hgetc();
+	d = lexgetc();
 	if(d == '&') {
-	    d = hgetc();
+	    d = lexgetc();
 	    if(d == '>') {
 		peekfd = c - '0';
 		hungetc('>');
@@ -779,6 +792,16 @@ gettok(void)
 	    add(c);
 	}
 	hwend();
+	if (hgetc == ingetc && inbufleft > 0 &&
+	    !(lexflags & LEXFLAGS_COMMENTS_KEEP)) {
+	    /* Nothing to record, so skip to the newline in one go. */
+	    char *nl = (char *)memchr(inbufptr, '\n', inbufleft);
+	    int skip = nl ? nl - inbufptr : inbufleft;
+
+	    inbufptr += skip;
+	    inbufleft -= skip;
+	    inbufct -= skip;
+	}
 	while ((c = ingetc()) != '\n' && !lexstop) {
 	    hwaddc(c);
 	    addtoline(c);
@@ -814,7 +837,7 @@ gettok(void)
     }
     switch (lexact1[STOUC(c)]) {
     case LX1_BKSLASH:
-	d = hgetc();
+	d = lexgetc();
 	if (d == '\n')
 	    goto beginning;
 	hungetc(d);
@@ -823,7 +846,7 @@ gettok(void)
     case LX1_NEWLIN:
 	return NEWLIN;
     case LX1_SEMI:
-	d = hgetc();
+	d = lexgetc();
 	if(d == ';')
 	    return DSEMI;
 	else if(d == '&')
@@ -834,18 +857,18 @@ gettok(void)
 	lexstop = 0;
 	return SEMI;
     case LX1_AMPER:
-	d = hgetc();
+	d = lexgetc();
 	if (d == '&')
 	    return DAMPER;
 	else if (d == '!' || d == '|')
 	    return AMPERBANG;
 	else if (d == '>') {
 	    tokfd = peekfd;
-	    d = hgetc();
+	    d = lexgetc();
 	    if (d == '!' || d == '|')
 		return OUTANGAMPBANG;
 	    else if (d == '>') {
-		d = hgetc();
+		d = lexgetc();
 		if (d == '!' || d == '|')
 		    return DOUTANGAMPBANG;
 		hungetc(d);
@@ -860,7 +883,7 @@ gettok(void)
 	lexstop = 0;
 	return AMPER;
     case LX1_BAR:
-	d = hgetc();
+	d = lexgetc();
 	if (d == '|')
 	    return DBAR;
 	else if (d == '&')
@@ -869,7 +892,7 @@ gettok(void)
 	lexstop = 0;
 	return BAR;
     case LX1_INPAR:
-	d = hgetc();
+	d = lexgetc();
 	if (d == '(') {
 	    if (infor) {
 		dbparens = 1;
@@ -904,7 +927,7 @@ gettok(void)
     case LX1_OUTPAR:
 	return OUTPAR;
     case LX1_INANG:
-	d = hgetc();
+	d = lexgetc();
 	if (d == '(') {
 	    hungetc(d);
 	    lexstop = 0;
@@ -918,7 +941,7 @@ gettok(void)
 	if (d == '>') {
 	    peek = INOUTANG;
 	} else if (d == '<') {
-	    int e = hgetc();
+	    int e = lexgetc();
 
 	    if (e == '(') {
 		hungetc(e);
@@ -944,12 +967,12 @@ gettok(void)
 	tokfd = peekfd;
 	return peek;
     case LX1_OUTANG:
-	d = hgetc();
+	d = lexgetc();
 	if (d == '(') {
 	    hungetc(d);
 	    goto unpeekfd;
 	} else if (d == '&') {
-	    d = hgetc();
+	    d = lexgetc();
 	    if (d == '!' || d == '|')
 		peek = OUTANGAMPBANG;
 	    else {
@@ -960,9 +983,9 @@ gettok(void)
 	} else if (d == '!' || d == '|')
 	    peek = OUTANGBANG;
 	else if (d == '>') {
-	    d = hgetc();
+	    d = lexgetc();
 	    if (d == '&') {
-		d = hgetc();
+		d = lexgetc();
 		if (d == '!' || d == '|')
 		    peek = DOUTANGAMPBANG;
 		else {
@@ -1049,7 +1072,7 @@ gettokstr(int c, int sub)
 		goto brk;
 	    break;
 	case LX2_META:
-	    c = hgetc();
+	    c = lexgetc();
 #ifdef DEBUG
 	    if (lexstop) {
 		fputs("BUG: input terminated by Meta\n", stderr);
@@ -1088,7 +1111,7 @@ gettokstr(int c, int sub)
 		c = Bar;
 	    break;
 	case LX2_STRING:
-	    e = hgetc();
+	    e = lexgetc();
 	    if (e == '[') {
 		cmdpush(CS_MATHSUBST);
 		add(String);
@@ -1145,7 +1168,7 @@ gettokstr(int c, int sub)
 	    }
 	    if (!in_brace_param) {
 		if (!sub) {
-		    e = hgetc();
+		    e = lexgetc();
 		    hungetc(e);
 		    lexstop = 0;
 		    /* For command words, parentheses are only
@@ -1227,7 +1250,7 @@ gettokstr(int c, int sub)
 	case LX2_OUTANG:
 	    if (in_brace_param || sub)
 		break;
-	    e = hgetc();
+	    e = lexgetc();
 	    if (e != '(') {
 		hungetc(e);
 		lexstop = 0;
@@ -1243,7 +1266,7 @@ gettokstr(int c, int sub)
 	case LX2_INANG:
 	    if (isset(SHGLOB) && sub)
 		break;
-	    e = hgetc();
+	    e = lexgetc();
 	    if (!(in_brace_param || sub) && e == '(') {
 		add(Inang);
 		if (skipcomm()) {
@@ -1256,7 +1279,7 @@ gettokstr(int c, int sub)
 	    hungetc(e);
 	    if(isnumglob()) {
 		add(Inang);
-		while ((c = hgetc()) != '>')
+		while ((c = lexgetc()) != '>')
 		    add(c);
 		c = Outang;
 		break;
@@ -1268,7 +1291,7 @@ gettokstr(int c, int sub)
 	case LX2_EQUALS:
 	    if (!sub) {
 		if (intpos) {
-		    e = hgetc();
+		    e = lexgetc();
 		    if (e != '(') {
 			hungetc(e);
 			lexstop = 0;
@@ -1299,7 +1322,7 @@ gettokstr(int c, int sub)
 		    if (*t == '+')
 			t++;
 		    if (t == bptr) {
-			e = hgetc();
+			e = lexgetc();
 			if (e == '(' && incmdpos) {
 			    *bptr = '\0';
 			    return ENVARRAY;
@@ -1315,9 +1338,9 @@ gettokstr(int c, int sub)
 	    }
 	    break;
 	case LX2_BKSLASH:
-	    c = hgetc();
+	    c = lexgetc();
 	    if (c == '\n') {
-		c = hgetc();
+		c = lexgetc();
 		if (!lexstop)
 		    continue;
 	    } else
@@ -1332,9 +1355,9 @@ gettokstr(int c, int sub)
 	    cmdpush(CS_QUOTE);
 	    for (;;) {
 		STOPHIST
-		while ((c = hgetc()) != '\'' && !lexstop) {
+		while ((c = lexgetc()) != '\'' && !lexstop) {
 		    if (strquote && c == '\\') {
-			c = hgetc();
+			c = lexgetc();
 			if (lexstop)
 			    break;
 			/*
@@ -1363,7 +1386,7 @@ gettokstr(int c, int sub)
 		    cmdpop();
 		    goto brk;
 		}
-		e = hgetc();
+		e = lexgetc();
 		if (e != '\'' || unset(RCQUOTES) || strquote)
 		    break;
 		add(c);
@@ -1391,9 +1414,9 @@ gettokstr(int c, int sub)
 	    cmdpush(CS_BQUOTE);
 	    SETPARBEGIN
 	    inquote = 0;
-	    while ((c = hgetc()) != '`' && !lexstop) {
+	    while ((c = lexgetc()) != '`' && !lexstop) {
 		if (c == '\\') {
-		    c = hgetc();
+		    c = lexgetc();
 		    if (c != '\n') {
 			add(c == '`' || c == '\\' || c == '$' ? Bnull : '\\');
 			add(c);
@@ -1426,7 +1449,7 @@ gettokstr(int c, int sub)
 	    break;
 	}
 	add(c);
-	c = hgetc();
+	c = lexgetc();
 	if (intpos)
 	    intpos--;
 	if (lexstop)
@@ -1470,13 +1493,13 @@ dquote_parse(char endchar, int sub)
     int math = endchar == ')' || endchar == ']';
     int zlemath = math && zlemetacs > zlemetall + addedx - inbufct;
 
-    while (((c = hgetc()) != endchar || bct ||
+    while (((c = lexgetc()) != endchar || bct ||
 	    (math && ((pct > 0) || (brct > 0))) ||
 	    intick) && !lexstop) {
       cont:
 	switch (c) {
 	case '\\':
-	    c = hgetc();
+	    c = lexgetc();
 	    if (c != '\n') {
 		if (c == '$' || c == '\\' || (c == '}' && !intick && bct) ||
 		    c == endchar || c == '`' ||
@@ -1499,7 +1522,7 @@ dquote_parse(char endchar, int sub)
 	case '$':
 	    if (intick)
 		break;
-	    c = hgetc();
+	    c = lexgetc();
 	    if (c == '(') {
 		add(Qstring);
 		err = cmd_or_math_sub();
@@ -1712,7 +1735,7 @@ parse_subst_string(char *s)
     len = 0;
     bptr = tokstr = s;
     bsiz = l + 1;
-    c = hgetc();
+    c = lexgetc();
     ctok = gettokstr(c, 1);
     err = errflag;
     strinend();
@@ -1791,6 +1814,53 @@ gotword(void)
     }
 }
 
+/*
+ * Called after the reserved word coproc to look for a `{name}'
+ * giving the name of the coprocess, as in the `{name}>file' form of
+ * redirection.  If it is there it is consumed and the name returned;
+ * otherwise the input is left untouched and NULL returned.
+ */
+
+/**/
+char *
+lexcoprocname(void)
+{
+    char buf[256];
+    int c, len = 0, namestart, nameend = 0, ok = 0;
+
+    while ((c = lexgetc()) == ' ' || c == '\t') {
+	if (lexstop || len == sizeof(buf) - 1)
+	    break;
+	buf[len++] = c;
+    }
+    if (!lexstop && c == '{' && len < (int)sizeof(buf) - 1) {
+	buf[len++] = c;
+	namestart = len;
+	while (!lexstop && len < (int)sizeof(buf) - 1 &&
+	       iident(c = lexgetc()) && (len > namestart || !idigit(c)))
+	    buf[len++] = c;
+	if (!lexstop && c == '}' && len > namestart &&
+	    len < (int)sizeof(buf) - 1) {
+	    nameend = len;
+	    buf[len++] = c;
+	    c = lexgetc();
+	    ok = !lexstop && (c == ' ' || c == '\t');
+	}
+    }
+    /* Put back the last character read, and the rest if no name. */
+    if (lexstop)
+	lexstop = 0;
+    else
+	hungetc(c);
+    if (ok) {
+	buf[nameend] = '\0';
+	return dupstring(buf + namestart);
+    }
+    while (len)
+	hungetc(buf[--len]);
+    return NULL;
+}
+
 /* expand aliases and reserved words */
 
 /**/
@@ -1900,7 +1970,7 @@ skipcomm(void)
     do {
 	int iswhite;
 	add(c);
-	c = hgetc();
+	c = lexgetc();
 	if (itok(c) || lexstop)
 	    break;
 	iswhite = inblank(c);
@@ -1913,16 +1983,16 @@ skipcomm(void)
 	    break;
 	case '\\':
 	    add(c);
-	    c = hgetc();
+	    c = lexgetc();
 	    break;
 	case '\'': {
 	    int strquote = bptr[-1] == '$';
 	    add(c);
 	    STOPHIST
-	    while ((c = hgetc()) != '\'' && !lexstop) {
+	    while ((c = lexgetc()) != '\'' && !lexstop) {
 		if (c == '\\' && strquote) {
 		    add(c);
-		    c = hgetc();
+		    c = lexgetc();
 		}
 		add(c);
 	    }
@@ -1931,25 +2001,25 @@ skipcomm(void)
 	}
 	case '\"':
 	    add(c);
-	    while ((c = hgetc()) != '\"' && !lexstop)
+	    while ((c = lexgetc()) != '\"' && !lexstop)
 		if (c == '\\') {
 		    add(c);
-		    add(hgetc());
+		    add(lexgetc());
 		} else
 		    add(c);
 	    break;
 	case '`':
 	    add(c);
-	    while ((c = hgetc()) != '`' && !lexstop)
+	    while ((c = lexgetc()) != '`' && !lexstop)
 		if (c == '\\')
-		    add(c), add(hgetc());
+		    add(c), add(lexgetc());
 		else
 		    add(c);
 	    break;
 	case '#':
 	    if (start) {
 		add(c);
-		while ((c = hgetc()) != '\n' && !lexstop)
+		while ((c = lexgetc()) != '\n' && !lexstop)
 		    add(c);
 		iswhite = 1;
 	    }
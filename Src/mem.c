@@ -285,6 +285,7 @@ pushheap(void)
 #if defined(ZSH_MEM) && defined(ZSH_MEM_DEBUG)
     h_push++;
 #endif
+    perfcounts[PC_PUSHHEAP]++;
 
     for (h = heaps; h; h = h->next) {
 	DPUTS(!h->used, "BUG: empty heap");
@@ -396,6 +397,7 @@ popheap(void)
 #if defined(ZSH_MEM) && defined(ZSH_MEM_DEBUG)
     h_pop++;
 #endif
+    perfcounts[PC_POPHEAP]++;
 
     fheap = NULL;
     for (h = heaps; h; h = hn) {
@@ -494,7 +496,7 @@ zheapptr(void *p)
 mod_export void *
 zhalloc(size_t size)
 {
-    Heap h;
+    Heap h, hp = NULL;
     size_t n;
 
     size = (size + H_ISIZE - 1) & ~(H_ISIZE - 1);
@@ -507,9 +509,19 @@ zhalloc(size_t size)
 
     /* find a heap with enough free space */
 
-    for (h = ((fheap && ARENA_SIZEOF(fheap) >= (size + fheap->used))
-	      ? fheap : heaps);
-	 h; h = h->next) {
+    /*
+     * This used to start over at heaps whenever fheap had too little
+     * room left.  Once a lot is allocated, as when adding many
+     * completion matches, there are thousands of arenas and every
+     * allocation that didn't fit in the last one swept over all of
+     * them.  The arenas before fheap were full when popheap() or
+     * freeheap() chose it, or had less room left than the arena added
+     * below; what little room they may have is left unused until the
+     * heap is next freed.  The same loop finds the last arena, to which
+     * a new one is appended.
+     */
+    for (h = (fheap ? fheap : heaps); h; h = h->next) {
+	hp = h;
 	if (ARENA_SIZEOF(h) >= (n = size + h->used)) {
 	    void *ret;
 
@@ -527,7 +539,6 @@ zhalloc(size_t size)
 	}
     }
     {
-	Heap hp;
         /* not found, allocate new heap */
 #if defined(ZSH_MEM) && !defined(USE_MMAP)
 	static int called = 0;
@@ -536,7 +547,6 @@ zhalloc(size_t size)
 #endif
 
 	n = HEAP_ARENA_SIZE > size ? HEAPSIZE : size + sizeof(*h);
-	for (hp = NULL, h = heaps; h; hp = h, h = h->next);
 
 #ifdef USE_MMAP
 	h = mmap_heap_alloc(&n);
@@ -566,7 +576,13 @@ zhalloc(size_t size)
 	    hp->next = h;
 	else
 	    heaps = h;
-	fheap = h;
+	/*
+	 * Keep searching from the old fheap if it has more room left,
+	 * as when this is a large allocation given an arena of its own.
+	 */
+	if (!fheap || ARENA_SIZEOF(h) - h->used >=
+	    ARENA_SIZEOF(fheap) - fheap->used)
+	    fheap = h;
 
 	unqueue_signals();
 #ifdef ZSH_HEAP_DEBUG
@@ -2181,6 +2181,22 @@ modname_ok(char const *p)
 /**/
 mod_export int
 load_module(char const *name, Feature_enables enablesarr, int silent)
+{
+    int ret, prof;
+
+    if (!startprofiling || module_loaded(name))
+	return load_module_now(name, enablesarr, silent);
+    prof = startprofbegin(dyncat("zmodload ", name));
+    ret = load_module_now(name, enablesarr, silent);
+    startprofend(prof);
+    return ret;
+}
+
+/* The work of load_module(), apart from the startup profile. */
+
+/**/
+static int
+load_module_now(char const *name, Feature_enables enablesarr, int silent)
 {
     Module m;
     void *handle = NULL;
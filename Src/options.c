@@ -186,6 +186,7 @@ static struct optname optns[] = {
 {{NULL, "magicequalsubst",    OPT_EMULATE},		 MAGICEQUALSUBST},
 {{NULL, "mailwarning",	      0},			 MAILWARNING},
 {{NULL, "markdirs",	      0},			 MARKDIRS},
+{{NULL, "memorytempfiles",    0},			 MEMORYTEMPFILES},
 {{NULL, "menucomplete",	      0},			 MENUCOMPLETE},
 {{NULL, "monitor",	      OPT_SPECIAL},		 MONITOR},
 {{NULL, "multibyte",
@@ -228,6 +229,7 @@ static struct optname optns[] = {
 {{NULL, "rcexpandparam",      OPT_EMULATE},		 RCEXPANDPARAM},
 {{NULL, "rcquotes",	      OPT_EMULATE},		 RCQUOTES},
 {{NULL, "rcs",		      OPT_ALL},			 RCS},
+{{NULL, "readahead",	      0},			 READAHEAD},
 {{NULL, "recexact",	      0},			 RECEXACT},
 {{NULL, "rematchpcre",	      0},			 REMATCHPCRE},
 {{NULL, "restricted",	      OPT_SPECIAL},		 RESTRICTED},
@@ -243,6 +245,7 @@ static struct optname optns[] = {
 {{NULL, "shwordsplit",	      OPT_EMULATE|OPT_BOURNE},	 SHWORDSPLIT},
 {{NULL, "singlecommand",      OPT_SPECIAL},		 SINGLECOMMAND},
 {{NULL, "singlelinezle",      OPT_KSH},			 SINGLELINEZLE},
+{{NULL, "sourcecache",        0},			 SOURCECACHE},
 {{NULL, "sourcetrace",        0},			 SOURCETRACE},
 {{NULL, "sunkeyboardhack",    0},			 SUNKEYBOARDHACK},
 {{NULL, "transientrprompt",   0},			 TRANSIENTRPROMPT},
@@ -193,6 +193,8 @@ static const struct gsu_integer euid_gsu =
 { euidgetfn, euidsetfn, stdunsetfn };
 static const struct gsu_integer ttyidle_gsu =
 { ttyidlegetfn, nullintsetfn, stdunsetfn };
+static const struct gsu_integer tracefd_gsu =
+{ intvargetfn, intvarsetfn, tracefdunsetfn };
 
 static const struct gsu_scalar username_gsu =
 { usernamegetfn, usernamesetfn, stdunsetfn };
@@ -324,6 +326,7 @@ IPDEF5U("ZLE_RPROMPT_INDENT", &rprompt_indent, zlevar_gsu),
 IPDEF5("OPTIND", &zoptind, varinteger_gsu),
 IPDEF5("SHLVL", &shlvl, varinteger_gsu),
 IPDEF5("TRY_BLOCK_ERROR", &try_errflag, varinteger_gsu),
+IPDEF5U("ZSH_TRACEFD", &zsh_tracefd, tracefd_gsu),
 
 #define IPDEF7(A,B) {{NULL,A,PM_SCALAR|PM_SPECIAL},BR((void *)B),GSU(varscalar_gsu),0,0,NULL,NULL,NULL,0}
 IPDEF7("OPTARG", &zoptarg),
@@ -3995,6 +3998,16 @@ histsizesetfn(UNUSED(Param pm), zlong v)
     resizehistents();
 }
 
+/* Function to unset special parameter `ZSH_TRACEFD', stopping the trace */
+
+/**/
+void
+tracefdunsetfn(Param pm, int exp)
+{
+    zsh_tracefd = 0;
+    stdunsetfn(pm, exp);
+}
+
 /* Function to get value for special parameter `SAVEHIST' */
 
 /**/
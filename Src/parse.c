@@ -98,6 +98,7 @@ struct heredocs *hdocs;
  *
  *   WC_SUBLIST
  *     - data contains type (&&, ||, END) and flags (coprog, not)
+ *     - if (flags & NAMED), followed by name of coprocess
  *     - followed by code for sublist
  *     - if not (type == END), followed by next WC_SUBLIST
  *
@@ -689,7 +690,7 @@ par_sublist(int *complex)
 }
 
 /*
- * sublist2	: [ COPROC | BANG ] pline
+ * sublist2	: [ COPROC [ "{" name "}" ] | BANG ] pline
  */
 
 /**/
@@ -699,8 +700,14 @@ par_sublist2(int *complex)
     int f = 0;
 
     if (tok == COPROC) {
+	char *name;
+
 	*complex = 1;
 	f |= WC_SUBLIST_COPROC;
+	if ((name = lexcoprocname())) {
+	    f |= WC_SUBLIST_NAMED;
+	    ecstr(name);
+	}
 	zshlex();
     } else if (tok == BANG) {
 	*complex = 1;
@@ -2387,6 +2394,268 @@ freeeprog(Eprog p)
     }
 }
 
+/*
+ * Cache of parsed programs, so that eval of the same string and (with
+ * SOURCE_CACHE) source of an unchanged file don't need parsing again.
+ *
+ * The result of parsing also depends on the options, the aliases and
+ * the comment character, so these are recorded with each entry and
+ * must match before it's used.  Entries are kept most recently used
+ * first and the last is dropped when the list is full.
+ */
+
+struct parsecache {
+    struct parsecache *next;
+    char *text;			/* the string for eval, else file name */
+    unsigned hash;		/* hash of text for eval */
+    Eprog prog;			/* permanent copy, one reference ours */
+    zlong aliasgen;		/* aliasgen when parsed */
+    int noaliases;		/* likewise noaliases */
+    char hashchar;		/* and the comment character */
+    char opts[OPT_SIZE];	/* and the options */
+    /* The following identify the version of a sourced file */
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    time_t mtime, ctime;
+    long mtimensec;
+};
+
+#define EVALCACHE_SIZE		64
+#define EVALCACHE_MAXLEN	65536
+#define SOURCECACHE_SIZE	32
+
+static struct parsecache *evalcache, *sourcecache;
+
+/* Statistics for the parsecache parameter in zsh/parameter */
+
+/**/
+mod_export zlong evalcache_hits, evalcache_misses, evalcache_entries;
+
+/**/
+mod_export zlong sourcecache_hits, sourcecache_misses, sourcecache_entries;
+
+/* Check the state that affects parsing is as it was for the entry. */
+
+static int
+parsecache_state_ok(struct parsecache *pc, char *optsnow)
+{
+    return pc->aliasgen == aliasgen && pc->noaliases == noaliases &&
+	pc->hashchar == hashchar && !memcmp(pc->opts, optsnow, OPT_SIZE);
+}
+
+/*
+ * Add a new entry at the head of a cache list, with a permanent copy
+ * of prog, dropping the last entry if the list is full.
+ */
+
+static struct parsecache *
+parsecache_add(struct parsecache **list, zlong *countp, int max,
+	       char *text, Eprog prog, char *optsnow)
+{
+    struct parsecache *pc, **pcp;
+
+    if (*countp == max) {
+	for (pcp = list; (*pcp)->next; pcp = &(*pcp)->next)
+	    ;
+	pc = *pcp;
+	*pcp = NULL;
+	freeeprog(pc->prog);
+	zsfree(pc->text);
+    } else {
+	pc = (struct parsecache *)zalloc(sizeof(*pc));
+	(*countp)++;
+    }
+    memset(pc, 0, sizeof(*pc));
+    pc->text = ztrdup(text);
+    pc->prog = dupeprog(prog, 0);
+    pc->aliasgen = aliasgen;
+    pc->noaliases = noaliases;
+    pc->hashchar = hashchar;
+    memcpy(pc->opts, optsnow, OPT_SIZE);
+    pc->next = *list;
+    *list = pc;
+
+    return pc;
+}
+
+/*
+ * Parse a string for eval, using the cache where possible.  The
+ * Eprog returned should be released with freeeprog() after use.
+ */
+
+/**/
+mod_export Eprog
+parse_eval(char *s)
+{
+    struct parsecache *pc, **pcp;
+    unsigned hash = hasher(s);
+    Eprog prog;
+
+    for (pcp = &evalcache; (pc = *pcp); pcp = &pc->next) {
+	if (pc->hash == hash && !strcmp(pc->text, s) &&
+	    parsecache_state_ok(pc, opts)) {
+	    *pcp = pc->next;
+	    pc->next = evalcache;
+	    evalcache = pc;
+	    evalcache_hits++;
+	    useeprog(pc->prog);
+	    return pc->prog;
+	}
+    }
+    evalcache_misses++;
+    if ((prog = parse_string(s, 1)) && strlen(s) <= EVALCACHE_MAXLEN) {
+	pc = parsecache_add(&evalcache, &evalcache_entries, EVALCACHE_SIZE,
+			    s, prog, opts);
+	pc->hash = hash;
+    }
+    return prog;
+}
+
+/*
+ * The options used as the key for a sourced file.  source() turns
+ * off SHIN_STDIN before running the file, so do the same here.
+ */
+
+/**/
+static void
+sourcecache_opts(char *optsbuf)
+{
+    memcpy(optsbuf, opts, OPT_SIZE);
+    optsbuf[SHINSTDIN] = 0;
+}
+
+static int
+sourcecache_same_file(struct parsecache *pc, struct stat *st)
+{
+    return pc->dev == st->st_dev && pc->ino == st->st_ino &&
+	pc->size == st->st_size && pc->mtime == st->st_mtime &&
+	pc->ctime == st->st_ctime
+#ifdef HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
+	&& pc->mtimensec == st->st_mtim.tv_nsec
+#endif
+	;
+}
+
+/*
+ * Look for a sourced file in the cache.  If found, return its Eprog,
+ * to be released with freeeprog() after use.
+ */
+
+/**/
+Eprog
+sourcecache_get(char *file)
+{
+    struct parsecache *pc, **pcp;
+    struct stat st;
+    char optsbuf[OPT_SIZE];
+
+    if (stat(file, &st) < 0)
+	return NULL;
+    sourcecache_opts(optsbuf);
+    for (pcp = &sourcecache; (pc = *pcp); pcp = &pc->next) {
+	if (sourcecache_same_file(pc, &st) &&
+	    parsecache_state_ok(pc, optsbuf)) {
+	    *pcp = pc->next;
+	    pc->next = sourcecache;
+	    sourcecache = pc;
+	    sourcecache_hits++;
+	    useeprog(pc->prog);
+	    return pc->prog;
+	}
+    }
+    sourcecache_misses++;
+    return NULL;
+}
+
+/*
+ * Record the state before a file is sourced in the usual way, so that
+ * sourcecache_put() can check nothing changed that would make parsing
+ * the whole file in one go give a different result.
+ */
+
+/**/
+void
+sourcecache_start(int fd, struct sourcecache_state *scs)
+{
+    if (fstat(fd, &scs->st) < 0)
+	scs->ok = 0;
+    else {
+	scs->ok = 1;
+	scs->aliasgen = aliasgen;
+	sourcecache_opts(scs->opts);
+    }
+}
+
+/*
+ * After a file has been sourced without error, parse it in one go and
+ * add it to the cache if the file, options and aliases are as before.
+ */
+
+/**/
+void
+sourcecache_put(char *file, struct sourcecache_state *scs)
+{
+    struct parsecache *pc, **pcp;
+    struct stat st;
+    char optsbuf[OPT_SIZE], *buf;
+    Eprog prog;
+    int fd, len, olastval, onoerrs;
+
+    sourcecache_opts(optsbuf);
+    if (!scs->ok || scs->aliasgen != aliasgen ||
+	memcmp(scs->opts, optsbuf, OPT_SIZE) ||
+	(fd = open(file, O_RDONLY | O_NOCTTY)) < 0)
+	return;
+    if (fstat(fd, &st) < 0 || st.st_dev != scs->st.st_dev ||
+	st.st_ino != scs->st.st_ino || st.st_size != scs->st.st_size ||
+	st.st_mtime != scs->st.st_mtime || !S_ISREG(st.st_mode)) {
+	close(fd);
+	return;
+    }
+    len = (int)st.st_size;
+    buf = (char *)zhalloc(len + 1);
+    if (read_loop(fd, buf, len) != len) {
+	close(fd);
+	return;
+    }
+    close(fd);
+    buf = metafy(buf, len, META_HEAPDUP);
+
+    /* It parsed before, but don't complain or change status if not */
+    olastval = lastval;
+    onoerrs = noerrs;
+    noerrs = 1;
+    prog = parse_string(buf, 1);
+    noerrs = onoerrs;
+    lastval = olastval;
+    if (!prog || errflag) {
+	errflag = 0;
+	return;
+    }
+    /* Any older version of the file is no use now */
+    for (pcp = &sourcecache; (pc = *pcp); pcp = &pc->next) {
+	if (pc->dev == st.st_dev && pc->ino == st.st_ino) {
+	    *pcp = pc->next;
+	    freeeprog(pc->prog);
+	    zsfree(pc->text);
+	    zfree(pc, sizeof(*pc));
+	    sourcecache_entries--;
+	    break;
+	}
+    }
+    pc = parsecache_add(&sourcecache, &sourcecache_entries,
+			SOURCECACHE_SIZE, file, prog, optsbuf);
+    pc->dev = st.st_dev;
+    pc->ino = st.st_ino;
+    pc->size = st.st_size;
+    pc->mtime = st.st_mtime;
+    pc->ctime = st.st_ctime;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM_TV_NSEC
+    pc->mtimensec = st.st_mtim.tv_nsec;
+#endif
+}
+
 /**/
 char *
 ecgetstr(Estate s, int dup, int *tokflag)
@@ -29,6 +29,11 @@
 
 #include "zsh.mdh"
 #include "signals.pro"
+
+#ifdef HAVE_PIDFD
+# include <sys/syscall.h>
+# include <poll.h>
+#endif
  
 /* Array describing the state of each signal: an element contains *
  * 0 for the default action or some ZSIG_* flags ored together.   */
@@ -398,6 +403,64 @@ signal_suspend(UNUSED(int sig), int wait_cmd)
     return ret;
 }
 
+/*
+ * Like signal_suspend(), but return only when one of the npids
+ * processes in pids exits or a signal other than SIGCHLD arrives,
+ * rather than whenever any child changes state.  This uses Linux
+ * pidfds, and on return any pending SIGCHLD has been handled so the
+ * caller can proceed as after signal_suspend().  Changes of state
+ * other than exiting are not noticed, so this is only used when
+ * job control is off.
+ *
+ * Must be called with SIGCHLD blocked.  Returns 0 without waiting
+ * if pidfds are unavailable or a SIGCHLD trap needs every signal,
+ * in which case the caller should use signal_suspend().
+ */
+
+/**/
+int
+signal_suspend_pids(pid_t *pids, int npids, int wait_cmd)
+{
+#ifdef HAVE_PIDFD
+    struct pollfd fds[MAX_SUSPEND_PIDS];
+    sigset_t set;
+    int i, nfds = 0;
+
+    if (jobbing || interact || (sigtrapped[SIGCHLD] & ZSIG_TRAPPED) ||
+	!npids)
+	return 0;
+    if (npids > MAX_SUSPEND_PIDS)
+	npids = MAX_SUSPEND_PIDS;
+    for (i = 0; i < npids; i++) {
+	int fd = (int)syscall(SYS_pidfd_open, pids[i], 0);
+	if (fd < 0)
+	    break;
+	fds[nfds].fd = fd;
+	fds[nfds].events = POLLIN;
+	nfds++;
+    }
+    if (nfds == npids) {
+	/* The same mask signal_suspend() would use, but keep SIGCHLD out */
+	sigemptyset(&set);
+	sigaddset(&set, SIGCHLD);
+	if (!(wait_cmd || isset(TRAPSASYNC) ||
+	      (sigtrapped[SIGINT] & ~ZSIG_IGNORED)))
+	    sigaddset(&set, SIGINT);
+	ppoll(fds, nfds, NULL, &set);
+    }
+    for (i = 0; i < nfds; i++)
+	close(fds[i].fd);
+    if (nfds < npids)
+	return 0;
+
+    /* Now let the handler reap whatever has exited. */
+    signal_setmask(child_unblock());
+    return 1;
+#else
+    return 0;
+#endif
+}
+
 /* last signal we handled: race prone, or what? */
 /**/
 int last_signal;
@@ -59,6 +59,12 @@
 #define child_block()      signal_block(sigchld_mask)
 #define child_unblock()    signal_unblock(sigchld_mask)
 
+/*
+ * Maximum number of processes signal_suspend_pids() watches at once.
+ * Watching a subset is fine since callers loop until all are done.
+ */
+#define MAX_SUSPEND_PIDS 64
+
 #ifdef SIGWINCH
 # define winch_block()      signal_block(signal_mask(SIGWINCH))
 # define winch_unblock()    signal_unblock(signal_mask(SIGWINCH))
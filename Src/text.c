@@ -339,13 +339,25 @@ gettext2(Estate state)
 	    break;
 	case WC_SUBLIST:
 	    if (!s) {
+		char *name = NULL;
+
+		if (WC_SUBLIST_FLAGS(code) & WC_SUBLIST_NAMED)
+		    name = ecgetstr(state, EC_NODUP, NULL);
                 if (!(WC_SUBLIST_FLAGS(code) & WC_SUBLIST_SIMPLE) &&
                     wc_code(*state->pc) != WC_PIPE)
                     stack = -1;
 		if (WC_SUBLIST_FLAGS(code) & WC_SUBLIST_NOT)
 		    taddstr(stack ? "!" : "! ");
-		if (WC_SUBLIST_FLAGS(code) & WC_SUBLIST_COPROC)
-		    taddstr(stack ? "coproc" : "coproc ");
+		if (WC_SUBLIST_FLAGS(code) & WC_SUBLIST_COPROC) {
+		    taddstr("coproc");
+		    if (name) {
+			taddstr(" {");
+			taddstr(name);
+			taddchr('}');
+		    }
+		    if (!stack)
+			taddchr(' ');
+		}
 		s = tpush(code, (WC_SUBLIST_TYPE(code) == WC_SUBLIST_END));
 	    } else {
 		if (!(stack = (WC_SUBLIST_TYPE(code) == WC_SUBLIST_END))) {
@@ -355,8 +367,14 @@ gettext2(Estate state)
 		    s->pop = (WC_SUBLIST_TYPE(s->code) == WC_SUBLIST_END);
 		    if (WC_SUBLIST_FLAGS(s->code) & WC_SUBLIST_NOT)
 			taddstr("! ");
-		    if (WC_SUBLIST_FLAGS(s->code) & WC_SUBLIST_COPROC)
+		    if (WC_SUBLIST_FLAGS(s->code) & WC_SUBLIST_COPROC) {
 			taddstr("coproc ");
+			if (WC_SUBLIST_FLAGS(s->code) & WC_SUBLIST_NAMED) {
+			    taddchr('{');
+			    taddstr(ecgetstr(state, EC_NODUP, NULL));
+			    taddstr("} ");
+			}
+		    }
 		}
 	    }
 	    if (stack < 1 && (WC_SUBLIST_FLAGS(s->code) & WC_SUBLIST_SIMPLE))
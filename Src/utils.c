@@ -30,6 +30,10 @@
 #include "zsh.mdh"
 #include "utils.pro"
 
+#if defined(HAVE_MEMFD_CREATE) && defined(HAVE_SYS_MMAN_H)
+#include <sys/mman.h>
+#endif
+
 /* name of script being sourced */
 
 /**/
@@ -1934,6 +1938,26 @@ gettempfile(const char *prefix, int use_heap, char **tempname)
     return fd;
 }
 
+/*
+ * Get an anonymous file held in memory, for use in place of a
+ * temporary file that is never referred to by name.  "name" is only
+ * used for diagnostics (it shows up under /proc).  Returns -1 if this
+ * isn't supported, in which case the caller should fall back to
+ * gettempfile().
+ */
+
+/**/
+mod_export int
+getmemtempfile(const char *name)
+{
+#if defined(HAVE_MEMFD_CREATE) && defined(HAVE_SYS_MMAN_H)
+    return memfd_create(name, 0);
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
 /* Check if a string contains a token */
 
 /**/
@@ -379,6 +379,11 @@ enum {
  */
 #define FDT_PROC_SUBST		6
 #endif
+/*
+ * Entry for the shell's end of a named coprocess.  Like FDT_EXTERNAL,
+ * but closed in other coprocesses so they don't hold it open.
+ */
+#define FDT_COPROC		7
 
 /* Flags for input stack */
 #define INP_FREE      (1<<0)	/* current buffer can be free'd            */
@@ -774,11 +779,12 @@ struct eccstr {
 #define WC_SUBLIST_END      0
 #define WC_SUBLIST_AND      1
 #define WC_SUBLIST_OR       2
-#define WC_SUBLIST_FLAGS(C) (wc_data(C) & ((wordcode) 0x1c))
+#define WC_SUBLIST_FLAGS(C) (wc_data(C) & ((wordcode) 0x3c))
 #define WC_SUBLIST_COPROC   4
 #define WC_SUBLIST_NOT      8
 #define WC_SUBLIST_SIMPLE  16
-#define WC_SUBLIST_FREE    (5)	/* Next bit available in integer */
+#define WC_SUBLIST_NAMED   32	/* coproc {name}: name follows */
+#define WC_SUBLIST_FREE    (6)	/* Next bit available in integer */
 #define WC_SUBLIST_SKIP(C)  (wc_data(C) >> WC_SUBLIST_FREE)
 #define WCB_SUBLIST(T,F,O)  wc_bld(WC_SUBLIST, \
 				   ((T) | (F) | ((O) << WC_SUBLIST_FREE)))
@@ -949,6 +955,9 @@ typedef struct timeinfo child_times_t;
 
 struct process {
     struct process *next;
+    struct process *pidnext;	/* next in the pid index chain      */
+    int job;			/* index of owning job in jobtab    */
+    int aux;			/* on the job's auxprocs list       */
     pid_t pid;                  /* process id                       */
     char text[JOBTEXTSIZE];	/* text to print when 'jobs' is run */
     int status;			/* return code from waitpid/wait3() */
@@ -1264,6 +1273,7 @@ struct builtin {
   * does not terminate options.
   */
 #define BINF_HANDLES_OPTS	(1<<18)
+#define BINF_NOJOB		(1<<19) /* can run without a job, see execsimplebuiltin() */
 
 struct module {
     struct hashnode node;
@@ -2113,6 +2123,7 @@ enum {
     MAGICEQUALSUBST,
     MAILWARNING,
     MARKDIRS,
+    MEMORYTEMPFILES,
     MENUCOMPLETE,
     MONITOR,
     MULTIBYTE,
@@ -2149,6 +2160,7 @@ enum {
     RCEXPANDPARAM,
     RCQUOTES,
     RCS,
+    READAHEAD,
     RECEXACT,
     REMATCHPCRE,
     RESTRICTED,
@@ -2164,6 +2176,7 @@ enum {
     SHWORDSPLIT,
     SINGLECOMMAND,
     SINGLELINEZLE,
+    SOURCECACHE,
     SOURCETRACE,
     SUNKEYBOARDHACK,
     TRANSIENTRPROMPT,
@@ -2214,6 +2227,17 @@ struct emulation_options {
     OptIndex *off_opts;
 };
 
+/*
+ * State recorded by sourcecache_start() when a file is sourced,
+ * checked by sourcecache_put() afterwards.
+ */
+struct sourcecache_state {
+    int ok;
+    zlong aliasgen;
+    struct stat st;
+    char opts[OPT_SIZE];
+};
+
 /***********************************************/
 /* Definitions for terminal and display control */
 /***********************************************/
@@ -2773,6 +2797,30 @@ enum {
 #define EXITHOOK       (zshhooks + 0)
 #define BEFORETRAPHOOK (zshhooks + 1)
 #define AFTERTRAPHOOK  (zshhooks + 2)
+#define BEFOREEXECHOOK (zshhooks + 3)
+#define AFTEREXECHOOK  (zshhooks + 4)
+
+/******************/
+/* Event counters */
+/******************/
+
+/*
+ * Indices into perfcounts[], which counts events in the shell for the
+ * zsh/perfcount module.  The names are in that module.
+ */
+enum {
+    PC_FORK,			/* zfork() */
+    PC_EXEC,			/* external commands, in execcmd() */
+    PC_CMDSUBST,		/* getoutput() */
+    PC_PATCOMPILE,		/* patcompile() */
+    PC_PARSE,			/* parse_string() */
+    PC_HASHLOOKUP,		/* gethashnode(), gethashnode2() */
+    PC_REHASH,			/* hashdir() */
+    PC_PUSHHEAP,		/* pushheap() */
+    PC_POPHEAP,			/* popheap() */
+    PC_AUTOLOAD,		/* loadautofn() */
+    PC_COUNT
+};
 
 #ifdef MULTIBYTE_SUPPORT
 #define nicezputs(str, outs)	(void)mb_niceformat((str), (outs), NULL, 0)